@@ -1,40 +1,584 @@
 #include "Log.h"
 
 #include <syslog.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/uio.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <signal.h>
+#include <cerrno>
+#ifdef LOG_HAVE_ZLIB
+#include <zlib.h>
+#endif
 #include <iostream>
-#include <sstream>
 #include <stdexcept>
-#include <iomanip>
+#include <algorithm>
+#include <cstring>
+#include <cstdint>
+#include <cmath>
+#include <fstream>
+#include <iterator>
 
 Log logger;
 
+namespace {
+	//! writes all parts, continuing after partial writes and interruptions
+	/*!
+	 * Errors are ignored, logging should not fail because of the log file.
+	 */
+	void writeFully( int fd, iovec* parts, int count) {
+		while( count) {
+			ssize_t written = ::writev( fd, parts, count);
+			if( written < 0) {
+				if( errno == EINTR)
+					continue;
+				return;
+			}
+			std::size_t left = static_cast<std::size_t>(written);
+			while( count && left >= parts->iov_len) {
+				left -= parts->iov_len;
+				++parts;
+				--count;
+			}
+			if( count) {
+				parts->iov_base = static_cast<char*>(parts->iov_base) + left;
+				parts->iov_len -= left;
+			}
+		}
+	}
+
+	//! writes the segments of rec followed by a newline to out
+	/*!
+	 * \return the number of characters of the message
+	 */
+	std::size_t writeSegments( std::ostream& out, const LogRecord& rec) {
+		iovec parts[LogRecord::maxSegments];
+		std::size_t count = rec.segments( parts);
+		std::size_t len = 0;
+		for( std::size_t i = 0; i < count; ++i) {
+			out.write( static_cast<const char*>(parts[i].iov_base), static_cast<std::streamsize>(parts[i].iov_len));
+			len += parts[i].iov_len;
+		}
+		out << std::endl;
+		return len;
+	}
+
+#ifdef LOG_HAVE_ZLIB
+	//! compresses source to target and removes source
+	void gzipFile( const std::string& source, const std::string& target) {
+		int in = ::open( source.c_str(), O_RDONLY | O_CLOEXEC);
+		if( in < 0)
+			return;
+		gzFile out = gzopen( target.c_str(), "wb");
+		if( !out) {
+			::close( in);
+			return;
+		}
+
+		char chunk[64 * 1024];
+		ssize_t n;
+		bool ok = true;
+		while( ok && ( n = ::read( in, chunk, sizeof(chunk))) > 0)
+			ok = gzwrite( out, chunk, static_cast<unsigned>(n)) == n;
+		ok = gzclose( out) == Z_OK && ok && n == 0;
+		::close( in);
+
+		if( ok)
+			::unlink( source.c_str());
+		else
+			::unlink( target.c_str());
+	}
+#endif
+
+	//! layout of the start of a ring file
+	struct RingFileHeader {
+		char magic[8];
+		std::uint64_t capacity;
+		//! position of the next record, claimed atomically by the writers
+		std::uint64_t position;
+		std::uint64_t reserved[5];
+	};
+
+	//! layout of a record in a ring file, followed by the message
+	struct RingRecord {
+		//! recordMagic or paddingMagic, written last
+		std::uint32_t magic;
+		//! length of the message
+		std::uint32_t length;
+		//! position of the record in the stream of all records
+		std::uint64_t position;
+		std::uint32_t level;
+		std::uint32_t reserved;
+	};
+
+	const char ringFileMagic[8] = { 's', 'l', 'o', 'g', 'r', 'i', 'n', 'g' };
+	const std::uint32_t recordMagic = 0x52474f4c;
+	//! marks the unused end of the file before the records wrap around
+	const std::uint32_t paddingMagic = 0x44415050;
+
+	//! bytes used by a record holding a message of the given length
+	std::size_t recordSize( std::size_t length) {
+		return ( sizeof(RingRecord) + length + 7) & ~std::size_t(7);
+	}
+
+	const char binaryFileMagic[8] = { 's', 'l', 'o', 'g', 'b', 'i', 'n', '1' };
+
+	//! record types of a binary log file
+	enum BinaryRecordType {
+		BR_site = 'S',		///< id, line, file length, format length, file, format
+		BR_deferred = 'M',	///< call site id, level, argument length, arguments
+		BR_text = 'T'		///< level, text length, text
+	};
+
+	void appendUint32( std::string& out, std::size_t value) {
+		std::uint32_t n = static_cast<std::uint32_t>(value);
+		out.append( reinterpret_cast<const char*>(&n), sizeof(n));
+	}
+
+	//! reads the fields of a binary log file, checking its bounds
+	class BinaryReader {
+	public:
+		BinaryReader( const std::string& data) : p( data.data()), end( data.data() + data.size()) {}
+
+		bool atEnd() const { return p == end; }
+
+		char type() {
+			need( 1);
+			return *p++;
+		}
+
+		std::uint32_t uint32() {
+			std::uint32_t n;
+			need( sizeof(n));
+			std::memcpy( &n, p, sizeof(n));
+			p += sizeof(n);
+			return n;
+		}
+
+		std::string string( std::uint32_t len) {
+			need( len);
+			p += len;
+			return std::string( p - len, len);
+		}
+	private:
+		void need( std::size_t len) {
+			if( static_cast<std::size_t>(end - p) < len)
+				throw std::invalid_argument("truncated binary log file");
+		}
+
+		const char* p;
+		const char* end;
+	};
+
+	const char* levelNames[] = { "emerg", "alert", "critical", "error", "warning", "notice", "info", "debug" };
+
+	//! appends str as quoted JSON string
+	void appendJsonString( std::string& out, const char* str, std::size_t len) {
+		static const char hex[] = "0123456789abcdef";
+		out.push_back( '"');
+		const char* plain = str;
+		for( const char* end = str + len; str != end; ++str) {
+			unsigned char c = static_cast<unsigned char>(*str);
+			if( c >= 0x20 && c != '"' && c != '\\')
+				continue;
+			out.append( plain, static_cast<std::size_t>(str - plain));
+			plain = str + 1;
+			out.push_back( '\\');
+			switch( c) {
+			case '"': out.push_back( '"'); break;
+			case '\\': out.push_back( '\\'); break;
+			case '\n': out.push_back( 'n'); break;
+			case '\r': out.push_back( 'r'); break;
+			case '\t': out.push_back( 't'); break;
+			case '\b': out.push_back( 'b'); break;
+			case '\f': out.push_back( 'f'); break;
+			default:
+				out.append( "u00");
+				out.push_back( hex[c >> 4]);
+				out.push_back( hex[c & 0xf]);
+			}
+		}
+		out.append( plain, static_cast<std::size_t>(str - plain));
+		out.push_back( '"');
+	}
+
+	//! appends a decoded field value as JSON value
+	void appendJsonValue( std::string& out, const LogArguments::Argument& value) {
+		char number[LIB::max_chars];
+		switch( value.type) {
+		case LogArguments::AT_signed:
+			out.append( number, LIB::to_chars( number, value.s));
+			break;
+		case LogArguments::AT_unsigned:
+			out.append( number, LIB::to_chars( number, value.u));
+			break;
+		case LogArguments::AT_double:
+			// JSON has no representation for infinity and NaN
+			if( std::isfinite( value.d))
+				out.append( number, LIB::to_chars( number, value.d));
+			else
+				out.append( "null");
+			break;
+		case LogArguments::AT_bool:
+			out.append( value.u ? "true" : "false");
+			break;
+		case LogArguments::AT_string:
+		case LogArguments::AT_char:
+		case LogArguments::AT_prefix:
+			appendJsonString( out, value.str, value.len);
+			break;
+		case LogArguments::AT_pointer:
+			out.push_back( '"');
+			out.append( number, LIB::to_chars( number, reinterpret_cast<const void*>(static_cast<std::uintptr_t>(value.u))));
+			out.push_back( '"');
+			break;
+		}
+	}
+} // namespace
+
+//! the links reached by messages of each log level
+/*!
+ * Flattens the links of a chain up to the first link overriding log(). For
+ * each log level it lists the links writing the message, those filtering it
+ * (only to count it) and finally the forwarding link, so writing a message
+ * is a loop over the links it reaches. The links following a forwarding link
+ * get their own LogDispatch, used by outputChain::log().
+ */
+class LogDispatch {
+public:
+	LogDispatch( outputChain* first);
+
+	void log( const LogRecord& rec) const;
+
+private:
+	LogDispatch( const LogDispatch&);
+	LogDispatch& operator=( const LogDispatch&);
+
+	enum Action { DA_write, DA_filter, DA_forward };
+	struct Step {
+		outputChain* link;
+		Action action;
+	};
+
+	std::vector<Step> steps[logLevels];
+	//! the links after the forwarding link ending this part of the chain
+	std::unique_ptr<LogDispatch> following;
+};
+
+LogDispatch::LogDispatch( outputChain* first) {
+	outputChain* forwarding = 0;
+	for( std::size_t ll = 0; ll < logLevels; ++ll) {
+		for( outputChain* link = first; link; link = link->nextLink) {
+			if( link->forwarding) {
+				steps[ll].push_back( Step{ link, DA_forward});
+				forwarding = link;
+				break;
+			}
+			if( ll > static_cast<std::size_t>( link->logLevel())) {
+				steps[ll].push_back( Step{ link, DA_filter});
+				continue;
+			}
+			steps[ll].push_back( Step{ link, DA_write});
+			if( !link->doPropagate)
+				break;
+		}
+	}
+
+	if( forwarding && forwarding->nextLink)
+		following.reset( new LogDispatch( forwarding->nextLink));
+	if( forwarding)
+		forwarding->following.store( following.get(), std::memory_order_release);
+}
+
+void LogDispatch::log( const LogRecord& rec) const {
+	for( const Step& step : steps[rec.level()]) {
+		switch( step.action) {
+		case DA_write:
+			step.link->write( rec);
+			break;
+		case DA_filter:
+			step.link->filteredByLevel.add( rec.level());
+			break;
+		case DA_forward:
+			step.link->log( rec);
+			break;
+		}
+	}
+}
+
 Log::Log()
-: output(0) {
+: output(0)
+, table(0)
+, level(-1)
+, queue(0)
+, droppedBefore(0)
+, highWaterBefore(0)
+, root(0)
+, chainLevel(-1) {
+}
+
+Log::Log( Log* root, const std::string& name)
+: output(0)
+, table(0)
+, level(-1)
+, queue(0)
+, droppedBefore(0)
+, highWaterBefore(0)
+, root(root)
+, m_name(name)
+, chainLevel(-1) {
 }
 
 Log::~Log() {
-	delete this->output;
+	stopAsync();
+	// links flushing on destruction still forward through their dispatch tables
+	delete this->output.load();
+	delete this->table.load();
+	for( LogDispatch* old : retired)
+		delete old;
 }
 
 LogWriter Log::message( LogLevel ll) {
+	if( !enabled( ll))
+		return LogWriter( 0, ll);
  	return LogWriter( this, ll);
 }
 
+Log& Log::child( const std::string& name) {
+	if( root)
+		return root->child( childName( name));
+	if( name.empty())
+		throw std::invalid_argument("child logger needs a name");
+
+	std::lock_guard<std::mutex> lk(m_config);
+	std::unique_ptr<Log>& child = children[name];
+	if( !child) {
+		child.reset( new Log( this, name));
+		child->level.store( std::min<int>( chainLevel, configuredLevel( name)), std::memory_order_relaxed);
+	}
+	return *child;
+}
+
+void Log::setLevel( const std::string& prefix, LogLevel ll) {
+	if( root) {
+		root->setLevel( childName( prefix), ll);
+		return;
+	}
+	std::lock_guard<std::mutex> lk(m_config);
+	eraseLevels( prefix);
+	levels[prefix] = ll;
+	applyLevels();
+}
+
+void Log::resetLevel( const std::string& prefix) {
+	if( root) {
+		root->resetLevel( childName( prefix));
+		return;
+	}
+	std::lock_guard<std::mutex> lk(m_config);
+	eraseLevels( prefix);
+	applyLevels();
+}
+
+std::string Log::childName( const std::string& prefix) const {
+	if( m_name.empty() || prefix.empty())
+		return m_name + prefix;
+	return m_name + '.' + prefix;
+}
+
+void Log::eraseLevels( const std::string& prefix) {
+	for( auto it = levels.lower_bound( prefix); it != levels.end() && !it->first.compare( 0, prefix.size(), prefix); ) {
+		// "net" covers "net.http", but not "network"
+		if( prefix.empty() || it->first.size() == prefix.size() || it->first[prefix.size()] == '.')
+			it = levels.erase( it);
+		else
+			++it;
+	}
+}
+
+LogLevel Log::configuredLevel( const std::string& name) const {
+	for( std::string prefix = name; ; ) {
+		auto found = levels.find( prefix);
+		if( found != levels.end())
+			return found->second;
+		if( prefix.empty())
+			return LL_debug;
+		std::size_t dot = prefix.rfind( '.');
+		prefix.erase( dot == std::string::npos ? 0 : dot);
+	}
+}
+
+void Log::applyLevels() {
+	level.store( std::min<int>( chainLevel, configuredLevel( "")), std::memory_order_relaxed);
+	for( auto& child : children)
+		child.second->level.store( std::min<int>( chainLevel, configuredLevel( child.first)), std::memory_order_relaxed);
+}
+
 void Log::setOutputChain( outputChain* output) {
-	delete this->output;
-	this->output = output;
+	replaceChain( output, 0);
 }
 
-void Log::log( LogLevel ll, const std::string& str) {
-	std::lock_guard<std::mutex> lk(m_m);
-	if( output)
-		output->log( ll, str);
+void Log::setOutputChain( outputChain* output, const std::vector<std::pair<std::string, LogLevel>>& levels) {
+	replaceChain( output, &levels);
+}
+
+void Log::replaceChain( outputChain* output, const std::vector<std::pair<std::string, LogLevel>>* levels) {
+	if( root)
+		throw std::invalid_argument("child loggers write to the output chain of their root");
+	for( outputChain* link = output; link; link = link->nextLink)
+		link->owner = this;
+
+	outputChain* old;
+	LogDispatch* oldTable;
+	std::vector<LogDispatch*> oldRetired;
+	{
+		std::lock_guard<std::mutex> lk(m_config);
+		old = this->output.exchange( output);
+		oldTable = table.exchange( output ? new LogDispatch( output) : 0);
+		oldRetired.swap( retired);
+		chainLevel = output ? output->mostVerbose( LL_emerg) : -1;
+		if( levels) {
+			this->levels.clear();
+			for( auto& level : *levels) {
+				eraseLevels( level.first);
+				this->levels[level.first] = level.second;
+			}
+		}
+		applyLevels();
+	}
+
+	Rcu::synchronize();
+	// links flushing on destruction still forward through the old tables
+	delete old;
+	delete oldTable;
+	for( LogDispatch* table : oldRetired)
+		delete table;
+}
+
+void Log::updateLevel() {
+	LogDispatch* old;
+	{
+		std::lock_guard<std::mutex> lk(m_config);
+		outputChain* chain = output.load( std::memory_order_relaxed);
+		chainLevel = chain ? chain->mostVerbose( LL_emerg) : -1;
+		applyLevels();
+		old = table.exchange( chain ? new LogDispatch( chain) : 0);
+	}
+	retire( old);
+}
+
+void Log::retire( LogDispatch* old) {
+	// a thread writing a message cannot wait for itself
+	if( Rcu::reading()) {
+		std::lock_guard<std::mutex> lk(m_config);
+		retired.push_back( old);
+		return;
+	}
+	Rcu::synchronize();
+	delete old;
+}
+
+void Log::startAsync( std::size_t capacity, OverflowPolicy policy /* = OP_block */, LogLevel dropLL /* = LL_info */) {
+	if( root)
+		throw std::invalid_argument("child loggers write through the queue of their root");
+	stopAsync();
+	queue = new LogQueue( capacity, policy, dropLL);
+	worker = std::thread( &Log::asyncWorker, this);
+}
+
+void Log::stopAsync() {
+	if( !queue)
+		return;
+
+	queue->close();
+	worker.join();
+	droppedBefore += queue->dropped();
+	highWaterBefore = std::max( highWaterBefore, queue->highWater());
+	delete queue;
+	queue = 0;
+}
+
+void Log::flush() {
+	if( root) {
+		root->flush();
+		return;
+	}
+	if( queue && std::this_thread::get_id() != worker.get_id())
+		queue->flush();
+
+	Rcu::ReadLock rl;
+	if( outputChain* chain = output.load( std::memory_order_acquire))
+		chain->flush();
+}
+
+std::size_t Log::droppedMessages() const {
+	if( root)
+		return root->droppedMessages();
+	return droppedBefore + ( queue ? queue->dropped() : 0);
+}
+
+LogMetrics Log::metrics() const {
+	if( root)
+		return root->metrics();
+	LogMetrics m;
+	logged.read( m.logged);
+	dropped.read( m.dropped);
+	m.queueHighWater = std::max( highWaterBefore, queue ? queue->highWater() : 0);
+
+	Rcu::ReadLock rl;
+	for( outputChain* link = output.load( std::memory_order_acquire); link; link = link->nextLink)
+		m.links.push_back( link->metrics());
+	return m;
+}
+
+void Log::log( const LogRecord& rec) {
+	if( root) {
+		root->log( rec);
+		return;
+	}
+	if( !queue) {
+		logged.add( rec.level());
+		dispatch( rec);
+	} else if( queue->push( rec)) {
+		logged.add( rec.level());
+	} else {
+		dropped.add( rec.level());
+	}
+}
+
+void Log::dispatch( const LogRecord& rec) {
+	Rcu::ReadLock rl;
+	if( const LogDispatch* table = this->table.load( std::memory_order_acquire))
+		table->log( rec);
+}
+
+void Log::asyncWorker() {
+	LogQueue::Entry entry;
+	while( queue->pop( entry)) {
+		if( entry.site)
+			dispatch( LogRecord( entry.ll, *entry.site, entry.data, entry.time, entry.fields.empty() ? 0 : &entry.fields));
+		else
+			dispatch( LogRecord( entry.ll, entry.data, entry.fields.empty() ? 0 : &entry.fields, entry.time));
+		queue->done();
+	}
 }
 
 outputChain::outputChain( LogLevel minimumLL, bool doPropagate, outputChain* nextLink) {
 	this->doPropagate = doPropagate;
 	this->nextLink = nextLink;
 	this->minimumLL = minimumLL;
+	this->owner = 0;
+	this->threadSafe = false;
+	this->forwarding = false;
+	this->following = 0;
+	this->bytesWritten = 0;
+	this->writeTime = 0;
+	this->lockWait = 0;
+	this->timed = false;
 }
 
 outputChain::~outputChain() {
@@ -43,18 +587,112 @@ outputChain::~outputChain() {
 
 void outputChain::setLogLevel( LogLevel ll) {
 	minimumLL = ll;
+	if( owner)
+		owner->updateLevel();
 }
 
 LogLevel outputChain::logLevel() const {
-	return minimumLL;
+	return minimumLL.load( std::memory_order_relaxed);
 }
 
-void outputChain::log( LogLevel ll, const std::string& str) {
+void outputChain::log( const LogRecord& rec) {
+	LogLevel ll = rec.level();
+	LogLevel minimumLL = this->minimumLL.load( std::memory_order_relaxed);
 	if( ll <= minimumLL)
-		real_log( ll, str);
+		write( rec);
+	else
+		filteredByLevel.add( ll);
 	
-	if( nextLink && ( ll > minimumLL || (ll <= minimumLL && doPropagate) ) )
-		nextLink->log( ll, str);
+	if( !nextLink || ( ll <= minimumLL && !doPropagate))
+		return;
+	if( const LogDispatch* following = this->following.load( std::memory_order_acquire))
+		following->log( rec);
+	else
+		nextLink->log( rec);
+}
+
+void outputChain::real_logRecord( const LogRecord& rec) {
+	const std::string& text = rec.text();
+	real_log( rec.level(), text);
+	countBytes( text.size());
+}
+
+void outputChain::write( const LogRecord& rec) {
+	writtenByLevel.add( rec.level());
+	if( timed.load( std::memory_order_relaxed)) {
+		timedWrite( rec);
+		return;
+	}
+	if( threadSafe) {
+		real_logRecord( rec);
+		return;
+	}
+	std::lock_guard<std::mutex> lk(m_m);
+	real_logRecord( rec);
+}
+
+void outputChain::timedWrite( const LogRecord& rec) {
+	auto start = std::chrono::steady_clock::now();
+	std::unique_lock<std::mutex> lk( m_m, std::defer_lock);
+	if( !threadSafe)
+		lk.lock();
+	auto locked = std::chrono::steady_clock::now();
+	real_logRecord( rec);
+	auto done = std::chrono::steady_clock::now();
+	lockWait.fetch_add( std::chrono::duration_cast<std::chrono::nanoseconds>( locked - start).count(), std::memory_order_relaxed);
+	writeTime.fetch_add( std::chrono::duration_cast<std::chrono::nanoseconds>( done - locked).count(), std::memory_order_relaxed);
+}
+
+void outputChain::flushLink() {
+	if( threadSafe) {
+		real_flush();
+		return;
+	}
+	std::lock_guard<std::mutex> lk(m_m);
+	real_flush();
+}
+
+void outputChain::flush() {
+	flushLink();
+	if( nextLink)
+		nextLink->flush();
+}
+
+LinkMetrics outputChain::metrics() const {
+	LinkMetrics m;
+	writtenByLevel.read( m.written);
+	filteredByLevel.read( m.filtered);
+	m.bytes = bytesWritten.load( std::memory_order_relaxed);
+	m.writeTime = std::chrono::nanoseconds( writeTime.load( std::memory_order_relaxed));
+	m.lockWait = std::chrono::nanoseconds( lockWait.load( std::memory_order_relaxed));
+	return m;
+}
+
+void outputChain::setTimed( bool timed) {
+	for( outputChain* link = this; link; link = link->nextLink)
+		link->timed.store( timed, std::memory_order_relaxed);
+}
+
+void outputChain::setThreadSafe( bool threadSafe) {
+	this->threadSafe = threadSafe;
+}
+
+void outputChain::setForwarding( bool forwarding) {
+	this->forwarding = forwarding;
+}
+
+int outputChain::mostVerbose( int first) const {
+	LogLevel minimumLL = logLevel();
+	int written = first <= minimumLL ? minimumLL : -1;
+	return std::max( written, nextVerbose( first));
+}
+
+int outputChain::nextVerbose( int first) const {
+	LogLevel minimumLL = logLevel();
+	int next = doPropagate ? first : std::max<int>( first, minimumLL + 1);
+	if( !nextLink || next > LL_debug)
+		return -1;
+	return nextLink->mostVerbose( next);
 }
 
 coutChainLink::coutChainLink( LogLevel minimumLL, bool doPropagate /* = 1*/, outputChain* nextLink /* = 0*/)
@@ -66,6 +704,10 @@ void coutChainLink::real_log( LogLevel /* ll */, const std::string& str) {
 	std::cout << str << std::endl;
 }
 
+void coutChainLink::real_logRecord( const LogRecord& rec) {
+	countBytes( writeSegments( std::cout, rec));
+}
+
 cerrChainLink::cerrChainLink( LogLevel minimumLL, bool doPropagate /* = 1*/, outputChain* nextLink /* = 0*/) 
 : outputChain( minimumLL, doPropagate, nextLink) {}
 
@@ -75,27 +717,499 @@ void cerrChainLink::real_log( LogLevel /* ll */, const std::string& str) {
 	std::cerr << str << std::endl;
 }
 
+void cerrChainLink::real_logRecord( const LogRecord& rec) {
+	countBytes( writeSegments( std::cerr, rec));
+}
+
 fileChainLink::fileChainLink( const std::string& filename, bool overrideFile, LogLevel minimumLL, bool doPropagate /* = 1*/, outputChain* nextLink /* = 0*/)
-: outputChain( minimumLL, doPropagate, nextLink) {
-	if( overrideFile)
-		file.open(filename.c_str(), std::ios_base::out);
-	else
-		file.open(filename.c_str(), std::ios_base::app);
-	if( !file.is_open())
+: outputChain( minimumLL, doPropagate, nextLink)
+, filename( filename)
+, bufferSize( 0)
+, flushLL( LL_error)
+, written( 0)
+, flushInterval( 0)
+, maxBytes( 0)
+, rotationInterval( 0)
+, keep( 0)
+, compress( false)
+, rotateRequested( false)
+, rotationCount( 0)
+, stopping( false) {
+	int flags = O_WRONLY | O_CREAT | O_CLOEXEC | ( overrideFile ? O_TRUNC : O_APPEND);
+	fd = ::open( filename.c_str(), flags, 0666);
+	if( fd < 0)
 		throw std::invalid_argument("could not open log file");
+
+	struct stat st;
+	if( !::fstat( fd, &st))
+		written = static_cast<unsigned long long>(st.st_size);
 }
 
 fileChainLink::~fileChainLink() {
-	file.close();
+	if( worker.joinable()) {
+		{
+			std::lock_guard<std::mutex> lk(m_background);
+			stopping = true;
+		}
+		wakeBackground.notify_one();
+		worker.join();
+	}
+	if( compressor.joinable())
+		compressor.join();
+	real_flush();
+	::close( fd);
+}
+
+void fileChainLink::setBuffering( std::size_t bufferSize, std::chrono::milliseconds interval /* = 1000ms */, LogLevel flushLL /* = LL_error */) {
+	this->bufferSize = bufferSize;
+	this->flushLL = flushLL;
+	buffer.reserve( bufferSize);
+	if( bufferSize && interval.count() > 0) {
+		std::lock_guard<std::mutex> lk(m_background);
+		flushInterval = interval;
+		nextFlush = std::chrono::steady_clock::now() + interval;
+	}
+	startBackground();
+}
+
+void fileChainLink::setRotation( unsigned long long maxBytes, std::chrono::seconds interval, unsigned keep, bool compress /* = false */) {
+#ifndef LOG_HAVE_ZLIB
+	if( compress)
+		throw std::invalid_argument("log library was built without zlib, can not compress log files");
+#endif
+	{
+		std::lock_guard<std::mutex> lk(m_background);
+		this->maxBytes = maxBytes;
+		this->rotationInterval = interval;
+		this->nextRotation = std::chrono::steady_clock::now() + interval;
+		this->keep = keep;
+		this->compress = compress;
+	}
+	startBackground();
+}
+
+void fileChainLink::real_log( LogLevel ll, const std::string& str) {
+	iovec part = { const_cast<char*>(str.data()), str.size() };
+	writeMessage( ll, &part, 1, str.size());
+}
+
+void fileChainLink::real_logRecord( const LogRecord& rec) {
+	iovec parts[LogRecord::maxSegments];
+	std::size_t count = rec.segments( parts);
+	std::size_t len = 0;
+	for( std::size_t i = 0; i < count; ++i)
+		len += parts[i].iov_len;
+	writeMessage( rec.level(), parts, count, len);
+	countBytes( len);
+}
+
+void fileChainLink::writeMessage( LogLevel ll, const iovec* parts, std::size_t count, std::size_t len) {
+	countWritten( len + 1);
+	if( buffer.size() + len + 1 > bufferSize) {
+		writeOut( parts, count);
+		return;
+	}
+
+	for( std::size_t i = 0; i < count; ++i)
+		buffer.append( static_cast<const char*>(parts[i].iov_base), parts[i].iov_len);
+	buffer.push_back( '\n');
+	if( ll <= flushLL)
+		writeOut( 0, 0);
+}
+
+void fileChainLink::appended( LogLevel ll, std::size_t len) {
+	countWritten( len);
+	if( buffer.size() > bufferSize || ll <= flushLL)
+		writeOut( 0, 0);
+}
+
+void fileChainLink::countWritten( std::size_t len) {
+	written += len;
+	if( maxBytes && written >= maxBytes) {
+		std::lock_guard<std::mutex> lk(m_background);
+		rotateRequested = true;
+		wakeBackground.notify_one();
+	}
+}
+
+void fileChainLink::real_flush() {
+	if( buffer.size())
+		writeOut( 0, 0);
+}
+
+void fileChainLink::writeOut( const iovec* message, std::size_t count) {
+	char newline = '\n';
+	iovec parts[LogRecord::maxSegments + 2];
+	parts[0].iov_base = const_cast<char*>(buffer.data());
+	parts[0].iov_len = buffer.size();
+	std::copy( message, message + count, parts + 1);
+	parts[count + 1].iov_base = &newline;
+	parts[count + 1].iov_len = message ? 1 : 0;
+	writeFully( fd, parts, static_cast<int>(count + 2));
+	buffer.clear();
+}
+
+void fileChainLink::startBackground() {
+	if( !worker.joinable() && ( flushInterval.count() > 0 || maxBytes || rotationInterval.count() > 0))
+		worker = std::thread( &fileChainLink::background, this);
+}
+
+void fileChainLink::background() {
+	typedef std::chrono::steady_clock clock;
+	std::unique_lock<std::mutex> lk(m_background);
+	while( !stopping) {
+		clock::time_point wake = clock::time_point::max();
+		if( flushInterval.count() > 0)
+			wake = std::min( wake, nextFlush);
+		if( rotationInterval.count() > 0)
+			wake = std::min( wake, nextRotation);
+
+		if( !rotateRequested) {
+			if( wake == clock::time_point::max())
+				wakeBackground.wait( lk);
+			else
+				wakeBackground.wait_until( lk, wake);
+		}
+		if( stopping)
+			break;
+
+		clock::time_point now = clock::now();
+		bool flush = flushInterval.count() > 0 && now >= nextFlush;
+		if( flush)
+			nextFlush = now + flushInterval;
+		bool rotation = rotateRequested || ( rotationInterval.count() > 0 && now >= nextRotation);
+		if( rotation) {
+			rotateRequested = false;
+			nextRotation = now + rotationInterval;
+		}
+
+		lk.unlock();
+		if( flush)
+			flushLink();
+		if( rotation)
+			rotate();
+		lk.lock();
+	}
+}
+
+std::string fileChainLink::rotatedName( unsigned n, bool compressed) const {
+	return filename + "." + std::to_string( n) + ( compressed ? ".gz" : "");
+}
+
+void fileChainLink::rotate() {
+	// filename.1 must not be moved while it is compressed
+	if( compressor.joinable())
+		compressor.join();
+
+	for( unsigned n = keep; n > 0; --n) {
+		for( bool compressed : { false, true }) {
+			std::string name = rotatedName( n, compressed);
+			if( n == keep)
+				::unlink( name.c_str());
+			else
+				::rename( name.c_str(), rotatedName( n + 1, compressed).c_str());
+		}
+	}
+
+	// the new file is linked into place together with the swap, so every
+	// message written after the rename goes to the new file
+	std::string rotated = rotatedName( 1, false);
+	std::string fresh = filename + ".rotating";
+	int newFd = ::open( fresh.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0666);
+	if( newFd < 0)
+		return;
+
+	bool swapped = false;
+	{
+		std::lock_guard<std::mutex> lk(linkMutex());
+		if( !::rename( filename.c_str(), rotated.c_str())) {
+			if( !::rename( fresh.c_str(), filename.c_str())) {
+				std::swap( fd, newFd);
+				written = 0;
+				swapped = true;
+				++rotationCount;
+			} else
+				::rename( rotated.c_str(), filename.c_str());
+		}
+	}
+	::close( newFd);
+	if( !swapped) {
+		::unlink( fresh.c_str());
+		return;
+	}
+
+	if( !keep)
+		::unlink( rotated.c_str());
+#ifdef LOG_HAVE_ZLIB
+	else if( compress)
+		compressor = std::thread( gzipFile, rotated, rotatedName( 1, true));
+#endif
+}
+
+jsonFileChainLink::jsonFileChainLink( const std::string& filename, bool overrideFile, LogLevel minimumLL, bool doPropagate /* = 1*/, outputChain* nextLink /* = 0*/)
+: fileChainLink( filename, overrideFile, minimumLL, doPropagate, nextLink) {}
+
+void jsonFileChainLink::real_logRecord( const LogRecord& rec) {
+	std::size_t start = buffer.size();
+	const std::string& text = rec.text();
+	buffer.append( "{\"level\":\"");
+	buffer.append( levelNames[rec.level()]);
+	buffer.append( "\",\"message\":");
+	appendJsonString( buffer, text.data(), text.size());
+
+	const std::string& fields = rec.fields();
+	const char* p = fields.data();
+	const char* end = p + fields.size();
+	LogArguments::Argument key, value;
+	while( LogArguments::decode( p, end, key) && LogArguments::decode( p, end, value)) {
+		buffer.push_back( ',');
+		appendJsonString( buffer, key.str, key.len);
+		buffer.push_back( ':');
+		appendJsonValue( buffer, value);
+	}
+	buffer.append( "}\n");
+
+	std::size_t len = buffer.size() - start;
+	appended( rec.level(), len);
+	countBytes( len);
+}
+
+ringFileChainLink::ringFileChainLink( const std::string& filename, std::size_t capacity, LogLevel minimumLL, bool doPropagate /* = 1*/, outputChain* nextLink /* = 0*/)
+: outputChain( minimumLL, doPropagate, nextLink)
+, capacity( std::max<std::size_t>( ( capacity + 7) & ~std::size_t(7), 16 * sizeof(RingRecord))) {
+	mapSize = sizeof(RingFileHeader) + this->capacity;
+	int fd = ::open( filename.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0666);
+	if( fd < 0)
+		throw std::invalid_argument("could not open log file");
+
+	RingFileHeader existing;
+	struct stat st;
+	bool reuse = ::fstat( fd, &st) == 0 && static_cast<std::size_t>(st.st_size) == mapSize
+		&& ::pread( fd, &existing, sizeof(existing), 0) == sizeof(existing)
+		&& !std::memcmp( existing.magic, ringFileMagic, sizeof(ringFileMagic))
+		&& existing.capacity == this->capacity;
+	if( !reuse && ( ::ftruncate( fd, 0) || ::ftruncate( fd, static_cast<off_t>(mapSize)))) {
+		::close( fd);
+		throw std::invalid_argument("could not resize log file");
+	}
+
+	void* mapped = ::mmap( 0, mapSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	::close( fd);
+	if( mapped == MAP_FAILED)
+		throw std::invalid_argument("could not map log file");
+	map = static_cast<char*>(mapped);
+
+	RingFileHeader* header = reinterpret_cast<RingFileHeader*>(map);
+	if( !reuse) {
+		std::memcpy( header->magic, ringFileMagic, sizeof(ringFileMagic));
+		header->capacity = this->capacity;
+		header->position = 0;
+	}
 }
 
-void fileChainLink::real_log( LogLevel /* ll */, const std::string& str) {
-	file << str << std::endl;
+ringFileChainLink::~ringFileChainLink() {
+	::munmap( map, mapSize);
+}
+
+void ringFileChainLink::real_log( LogLevel ll, const std::string& str) {
+	RingFileHeader* header = reinterpret_cast<RingFileHeader*>(map);
+	char* data = map + sizeof(RingFileHeader);
+
+	std::size_t length = std::min( str.size(), capacity / 4 - sizeof(RingRecord));
+	std::size_t size = recordSize( length);
+
+	// claim the space in the header, so links mapping the same file, like the
+	// old and the new link while a chain is replaced, never overwrite each other
+	std::uint64_t start = __atomic_load_n( &header->position, __ATOMIC_RELAXED);
+	std::uint64_t position;
+	do {
+		std::size_t offset = static_cast<std::size_t>(start % capacity);
+		// a record not fitting before the end starts at the beginning
+		position = capacity - offset < size ? start + ( capacity - offset) : start;
+	} while( !__atomic_compare_exchange_n( &header->position, &start, position + size, true, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED));
+
+	if( position != start) {
+		// mark the rest before the end as unused
+		std::size_t offset = static_cast<std::size_t>(start % capacity);
+		if( capacity - offset >= sizeof(RingRecord)) {
+			RingRecord* padding = reinterpret_cast<RingRecord*>(data + offset);
+			__atomic_store_n( &padding->magic, 0, __ATOMIC_RELAXED);
+			padding->position = start;
+			__atomic_store_n( &padding->magic, paddingMagic, __ATOMIC_RELEASE);
+		}
+	}
+
+	RingRecord* record = reinterpret_cast<RingRecord*>(data + static_cast<std::size_t>(position % capacity));
+	__atomic_store_n( &record->magic, 0, __ATOMIC_RELAXED);
+	__atomic_thread_fence( __ATOMIC_RELEASE);
+	record->length = static_cast<std::uint32_t>(length);
+	record->position = position;
+	record->level = static_cast<std::uint32_t>(ll);
+	std::memcpy( record + 1, str.data(), length);
+	__atomic_store_n( &record->magic, recordMagic, __ATOMIC_RELEASE);
+}
+
+ringFileChainLink::Messages ringFileChainLink::readMessages( const std::string& filename) {
+	std::ifstream in( filename.c_str(), std::ios_base::binary);
+	std::string file( (std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+	RingFileHeader header;
+	if( file.size() < sizeof(header))
+		throw std::invalid_argument("not a ring log file");
+	std::memcpy( &header, file.data(), sizeof(header));
+	if( std::memcmp( header.magic, ringFileMagic, sizeof(ringFileMagic))
+			|| !header.capacity || file.size() != sizeof(header) + header.capacity)
+		throw std::invalid_argument("not a ring log file");
+
+	const char* data = file.data() + sizeof(header);
+	std::uint64_t capacity = header.capacity;
+	std::uint64_t end = header.position;
+	std::uint64_t p = end > capacity ? end - capacity : 0;
+
+	Messages messages;
+	while( p < end) {
+		std::size_t offset = static_cast<std::size_t>(p % capacity);
+		if( capacity - offset < sizeof(RingRecord)) {
+			p += capacity - offset;
+			continue;
+		}
+
+		RingRecord record;
+		std::memcpy( &record, data + offset, sizeof(record));
+		if( record.position != p) {
+			// an older record overwritten by the start of a newer one, search the next record
+			p += 8;
+		} else if( record.magic == paddingMagic) {
+			p += capacity - offset;
+		} else if( record.magic == recordMagic && offset + recordSize( record.length) <= capacity
+				&& p + recordSize( record.length) <= end && record.level <= LL_debug) {
+			messages.push_back( std::make_pair( static_cast<LogLevel>(record.level),
+				std::string( data + offset + sizeof(record), record.length)));
+			p += recordSize( record.length);
+		} else {
+			p += 8;
+		}
+	}
+	return messages;
+}
+
+binaryFileChainLink::binaryFileChainLink( const std::string& filename, LogLevel minimumLL, bool doPropagate /* = 1*/, outputChain* nextLink /* = 0*/)
+: outputChain( minimumLL, doPropagate, nextLink) {
+	// appending, so links writing the same file, like the old and the new
+	// link while a chain is replaced, never overwrite each other
+	fd = ::open( filename.c_str(), O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0666);
+	if( fd < 0)
+		throw std::invalid_argument("could not open log file");
+
+	char magic[sizeof(binaryFileMagic)];
+	if( ::pread( fd, magic, sizeof(magic), 0) == sizeof(magic) && !std::memcmp( magic, binaryFileMagic, sizeof(magic)))
+		return;
+	if( ::ftruncate( fd, 0)) {
+		::close( fd);
+		throw std::invalid_argument("could not truncate log file");
+	}
+	iovec header = { const_cast<char*>(binaryFileMagic), sizeof(binaryFileMagic) };
+	writeFully( fd, &header, 1);
+}
+
+binaryFileChainLink::~binaryFileChainLink() {
+	::close( fd);
+}
+
+void binaryFileChainLink::real_log( LogLevel ll, const std::string& str) {
+	record.clear();
+	record.push_back( BR_text);
+	appendUint32( record, ll);
+	appendUint32( record, str.size());
+	record.append( str);
+
+	iovec part = { &record[0], record.size() };
+	writeFully( fd, &part, 1);
+	countBytes( record.size());
+}
+
+void binaryFileChainLink::real_logRecord( const LogRecord& rec) {
+	if( !rec.deferred()) {
+		real_log( rec.level(), rec.text());
+		return;
+	}
+
+	const LogSite& site = *rec.site();
+	unsigned id = site.id();
+	record.clear();
+	if( id >= written.size())
+		written.resize( id + 1);
+	if( !written[id]) {
+		std::size_t fileLength = std::strlen( site.file);
+		std::size_t formatLength = std::strlen( site.format);
+		record.push_back( BR_site);
+		appendUint32( record, id);
+		appendUint32( record, site.line);
+		appendUint32( record, fileLength);
+		appendUint32( record, formatLength);
+		record.append( site.file, fileLength);
+		record.append( site.format, formatLength);
+		written[id] = true;
+	}
+
+	record.push_back( BR_deferred);
+	appendUint32( record, id);
+	appendUint32( record, rec.level());
+	appendUint32( record, rec.arguments().size());
+	record.append( rec.arguments());
+
+	iovec part = { &record[0], record.size() };
+	writeFully( fd, &part, 1);
+	countBytes( record.size());
+}
+
+binaryFileChainLink::Messages binaryFileChainLink::readMessages( const std::string& filename) {
+	std::ifstream in( filename.c_str(), std::ios_base::binary);
+	std::string file( (std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+	if( file.compare( 0, sizeof(binaryFileMagic), binaryFileMagic, sizeof(binaryFileMagic)))
+		throw std::invalid_argument("not a binary log file");
+	file.erase( 0, sizeof(binaryFileMagic));
+
+	std::vector<std::string> formats;
+	Messages messages;
+	BinaryReader reader( file);
+	while( !reader.atEnd()) {
+		char type = reader.type();
+		if( type == BR_site) {
+			std::uint32_t id = reader.uint32();
+			reader.uint32();
+			std::uint32_t fileLength = reader.uint32();
+			std::uint32_t formatLength = reader.uint32();
+			reader.string( fileLength);
+			if( id >= formats.size())
+				formats.resize( id + 1);
+			formats[id] = reader.string( formatLength);
+		} else if( type == BR_deferred || type == BR_text) {
+			std::uint32_t id = type == BR_deferred ? reader.uint32() : 0;
+			std::uint32_t level = reader.uint32();
+			std::string data = reader.string( reader.uint32());
+			if( level > LL_debug || ( type == BR_deferred && id >= formats.size()))
+				throw std::invalid_argument("corrupt binary log file");
+
+			if( type == BR_text) {
+				messages.push_back( std::make_pair( static_cast<LogLevel>(level), data));
+				continue;
+			}
+			MessageBuffer text;
+			LogArguments::format( formats[id].c_str(), data.data(), data.size(), text);
+			messages.push_back( std::make_pair( static_cast<LogLevel>(level), text.str()));
+		} else {
+			throw std::invalid_argument("corrupt binary log file");
+		}
+	}
+	return messages;
 }
 
 syslogChainLink::syslogChainLink( const std::string& progName, LogLevel minimumLL, bool doPropagate /* = 1*/, outputChain* nextLink /* = 0*/)
 : outputChain( minimumLL, doPropagate, nextLink) {
 	this->progName = progName;
+	// syslog() does its own locking
+	setThreadSafe( true);
 	openlog( this->progName.c_str(), LOG_CONS | LOG_PID, LOG_USER);
 	syslog( LOG_INFO, "started logging");
 }
@@ -109,39 +1223,715 @@ void syslogChainLink::real_log( LogLevel ll, const std::string& str) {
 	syslog( ll, "%s", str.c_str());
 }
 
+namespace {
+	//! frames passed to the syslog daemon with one sendmmsg() call
+	const unsigned syslogBatch = 64;
+	//! frames waiting for the sending thread before logging threads wait too
+	const std::size_t syslogMaxPending = 1024;
+
+	//! the local time in the format of RFC 3164, cached for the current second
+	char* rfc3164Time( char* out, long long time) {
+		struct Cache {
+			Cache() : second( -1) {}
+			long long second;
+			char text[16];
+		};
+		thread_local Cache cache;
+
+		long long second = time / 1000000000;
+		if( second != cache.second) {
+			time_t t = static_cast<time_t>(second);
+			tm date;
+			::localtime_r( &t, &date);
+			::strftime( cache.text, sizeof(cache.text), "%b %e %H:%M:%S", &date);
+			cache.second = second;
+		}
+		std::size_t len = std::strlen( cache.text);
+		std::memcpy( out, cache.text, len);
+		return out + len;
+	}
+} // namespace
+
+syslogSocketChainLink::syslogSocketChainLink( const std::string& identity, LogLevel minimumLL,
+		const std::string& socketPath /* = "/dev/log" */, SyslogFormat format /* = SF_rfc3164 */, int facility /* = 1 */,
+		bool doPropagate /* = 1 */, outputChain* nextLink /* = 0 */)
+: outputChain( minimumLL, doPropagate, nextLink)
+, socketPath( socketPath)
+, format( format)
+, facility( facility)
+, fd( -1)
+, pendingCount( 0)
+, sending( false) {
+	char pid[LIB::max_chars];
+	char* pidEnd = LIB::to_chars( pid, static_cast<long>( ::getpid()));
+	switch( format) {
+	case SF_rfc3164:
+		identityPart = " " + identity + "[" + std::string( pid, pidEnd) + "]: ";
+		break;
+	case SF_rfc5424: {
+		char host[256] = "-";
+		if( ::gethostname( host, sizeof(host) - 1) || !host[0])
+			std::strcpy( host, "-");
+		host[sizeof(host) - 1] = 0;
+		identityPart = std::string(" ") + host + " " + ( identity.empty() ? "-" : identity) + " " + std::string( pid, pidEnd) + " - - ";
+		break;
+	}
+	}
+
+	if( !connect())
+		throw std::invalid_argument("could not connect to syslog socket " + socketPath);
+	// batches are collected under m_pending
+	setThreadSafe( true);
+}
+
+syslogSocketChainLink::~syslogSocketChainLink() {
+	real_flush();
+	::close( fd);
+}
+
+void syslogSocketChainLink::real_log( LogLevel ll, const std::string& str) {
+	countBytes( send( ll, LogClock::now(), str));
+}
+
+void syslogSocketChainLink::real_logRecord( const LogRecord& rec) {
+	countBytes( send( rec.level(), rec.time(), rec.text()));
+}
+
+void syslogSocketChainLink::real_flush() {
+	std::unique_lock<std::mutex> lk(m_pending);
+	idle.wait( lk, [this] { return !sending && !pendingCount; });
+}
+
+char* syslogSocketChainLink::frameStart( char* out, LogLevel ll, long long time) const {
+	*out++ = '<';
+	out = LIB::to_chars( out, facility * 8 + ll);
+	*out++ = '>';
+	switch( format) {
+	case SF_rfc3164:
+		out = rfc3164Time( out, time);
+		break;
+	case SF_rfc5424:
+		*out++ = '1';
+		*out++ = ' ';
+		out = LogClock::format( out, time, TF_iso8601, 6);
+		break;
+	}
+	return out;
+}
+
+std::size_t syslogSocketChainLink::send( LogLevel ll, long long time, const std::string& str) {
+	char start[LogClock::maxFormatted + LIB::max_chars + 8];
+	char* end = frameStart( start, ll, time);
+
+	std::unique_lock<std::mutex> lk(m_pending);
+	idle.wait( lk, [this] { return pendingCount < syslogMaxPending; });
+	if( pendingCount == pending.size())
+		pending.resize( pendingCount + 1);
+	std::string& frame = pending[pendingCount++];
+	frame.assign( start, end);
+	frame.append( identityPart);
+	frame.append( str);
+	std::size_t len = frame.size();
+	if( sending)
+		return len;
+
+	// send the frames of all threads logging in the meantime too
+	sending = true;
+	while( pendingCount) {
+		std::size_t count = pendingCount;
+		pending.swap( batch);
+		pendingCount = 0;
+		lk.unlock();
+		idle.notify_all();
+		sendFrames( count);
+		lk.lock();
+	}
+	sending = false;
+	lk.unlock();
+	idle.notify_all();
+	return len;
+}
+
+void syslogSocketChainLink::sendFrames( std::size_t count) {
+	mmsghdr messages[syslogBatch];
+	iovec parts[syslogBatch];
+	bool reconnected = false;
+	std::size_t sent = 0;
+	while( sent < count) {
+		unsigned n = static_cast<unsigned>( std::min<std::size_t>( count - sent, syslogBatch));
+		std::memset( messages, 0, sizeof(messages));
+		for( unsigned i = 0; i < n; ++i) {
+			std::string& frame = batch[sent + i];
+			parts[i].iov_base = &frame[0];
+			parts[i].iov_len = frame.size();
+			messages[i].msg_hdr.msg_iov = &parts[i];
+			messages[i].msg_hdr.msg_iovlen = 1;
+		}
+		int result = ::sendmmsg( fd, messages, n, MSG_NOSIGNAL);
+		if( result > 0) {
+			sent += static_cast<std::size_t>(result);
+		} else if( result < 0 && errno == EINTR) {
+			continue;
+		} else if( result < 0 && errno == EMSGSIZE) {
+			// skip a frame too long for the socket
+			++sent;
+		} else if( !reconnected && connect()) {
+			// the daemon was restarted
+			reconnected = true;
+		} else {
+			// errors are ignored, logging should not fail because of syslog
+			return;
+		}
+	}
+}
+
+bool syslogSocketChainLink::connect() {
+	if( fd >= 0)
+		::close( fd);
+	fd = ::socket( AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+	if( fd < 0)
+		return false;
+
+	sockaddr_un address;
+	std::memset( &address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	if( socketPath.size() < sizeof(address.sun_path)) {
+		std::memcpy( address.sun_path, socketPath.c_str(), socketPath.size());
+		if( ::connect( fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0)
+			return true;
+	}
+	::close( fd);
+	fd = -1;
+	return false;
+}
+
 bufferingChainLink::bufferingChainLink( LogLevel minimumLL, bool doPropagate /* = 1 */, outputChain* nextLink /* = 0 */)
 : outputChain( minimumLL, doPropagate, nextLink) {}
 
 const bufferingChainLink::LogBuffer& bufferingChainLink::getMessages() {
+	for( std::size_t i = buffer.size(); i < shared.size(); ++i)
+		buffer.push_back( std::make_pair( shared[i].first, *shared[i].second));
 	return buffer;
 }
 
 void bufferingChainLink::clear() {
 	buffer.clear();
+	shared.clear();
 }
 
 void bufferingChainLink::real_log( LogLevel ll, const std::string& str) {
-	buffer.push_back( make_pair( ll, str));
+	shared.push_back( std::make_pair( ll, std::make_shared<const std::string>( str)));
+}
+
+void bufferingChainLink::real_logRecord( const LogRecord& rec) {
+	LogRecord::SharedText text = rec.share();
+	countBytes( text->size());
+	shared.push_back( std::make_pair( rec.level(), std::move( text)));
+}
+
+namespace {
+	//! a link registered with captureChainLink::dumpOnCrash()
+	struct CrashDump {
+		std::atomic<const captureChainLink*> link;
+		std::atomic<int> fd;
+	};
+
+	const std::size_t maxCrashDumps = 8;
+	CrashDump crashDumps[maxCrashDumps];
+	//! serializes registering links, the signal handler only reads crashDumps
+	std::mutex m_crashDumps;
+
+	const int crashSignals[] = { SIGSEGV, SIGBUS, SIGFPE, SIGILL, SIGABRT };
+	const std::size_t crashSignalCount = sizeof(crashSignals) / sizeof(crashSignals[0]);
+	//! the handlers replaced by crashHandler
+	struct sigaction previousHandlers[crashSignalCount];
+	std::once_flag crashHandlersInstalled;
+
+	void crashHandler( int sig) {
+		for( auto& dump : crashDumps) {
+			if( const captureChainLink* link = dump.link.load( std::memory_order_acquire))
+				link->dump( dump.fd.load( std::memory_order_relaxed));
+		}
+		// let the previous handler or the default action handle the signal
+		for( std::size_t i = 0; i < crashSignalCount; ++i) {
+			if( crashSignals[i] == sig)
+				::sigaction( sig, &previousHandlers[i], 0);
+		}
+		::raise( sig);
+	}
+
+	//! number of words holding len characters
+	std::size_t wordsFor( std::size_t len) {
+		return ( len + 7) / 8;
+	}
+} // namespace
+
+captureChainLink::captureChainLink( std::size_t capacity, std::size_t maxLength, LogLevel minimumLL, bool doPropagate /* = 1 */, outputChain* nextLink /* = 0 */)
+: outputChain( minimumLL, doPropagate, nextLink)
+, capacity( capacity)
+, maxLength( maxLength)
+, slotWords( 3 + wordsFor( maxLength))
+, next( 0)
+, crashFd( -1) {
+	if( !capacity)
+		throw std::invalid_argument("capture link needs at least one slot");
+	slots.reset( new std::atomic<unsigned long long>[ capacity * slotWords]());
+	dumpBuffer.reset( new char[ maxLength]);
+	dumping.clear();
+	// slots are claimed atomically
+	setThreadSafe( true);
+}
+
+captureChainLink::~captureChainLink() {
+	if( crashFd < 0)
+		return;
+	std::lock_guard<std::mutex> lk(m_crashDumps);
+	for( auto& dump : crashDumps) {
+		if( dump.link.load( std::memory_order_relaxed) == this)
+			dump.link.store( 0, std::memory_order_release);
+	}
+}
+
+void captureChainLink::real_log( LogLevel ll, const std::string& str) {
+	append( ll, LogClock::now(), str);
 }
 
-taggingChainLink::taggingChainLink(outputChain* nextLink /* = 0 */)
-: outputChain( LL_debug, true, nextLink) {
-	m_tp = std::chrono::system_clock::now();
+void captureChainLink::real_logRecord( const LogRecord& rec) {
+	append( rec.level(), rec.time(), rec.text());
+}
+
+void captureChainLink::append( LogLevel ll, long long time, const std::string& str) {
+	unsigned long long sequence = next.fetch_add( 1, std::memory_order_relaxed);
+	std::atomic<unsigned long long>* slot = &slots[ ( sequence % capacity) * slotWords];
+	unsigned long long writing = 2 * sequence + 1;
+	unsigned long long version = slot[0].load( std::memory_order_relaxed);
+	for( ;;) {
+		// a newer message took the slot already
+		if( version >= writing)
+			return;
+		// an older message is still being written
+		if( version & 1) {
+			std::this_thread::yield();
+			version = slot[0].load( std::memory_order_relaxed);
+			continue;
+		}
+		if( slot[0].compare_exchange_weak( version, writing, std::memory_order_relaxed))
+			break;
+	}
+	std::atomic_thread_fence( std::memory_order_release);
+
+	std::size_t len = std::min( str.size(), maxLength);
+	slot[1].store( static_cast<unsigned long long>(ll) << 32 | len, std::memory_order_relaxed);
+	slot[2].store( static_cast<unsigned long long>(time), std::memory_order_relaxed);
+	for( std::size_t i = 0; i < wordsFor( len); ++i) {
+		unsigned long long word = 0;
+		std::memcpy( &word, str.data() + 8 * i, std::min<std::size_t>( 8, len - 8 * i));
+		slot[3 + i].store( word, std::memory_order_relaxed);
+	}
+	slot[0].store( writing + 1, std::memory_order_release);
+	countBytes( len);
+}
+
+bool captureChainLink::read( unsigned long long sequence, LogLevel& ll, long long& time, char* text, std::size_t& len) const {
+	const std::atomic<unsigned long long>* slot = &slots[ ( sequence % capacity) * slotWords];
+	unsigned long long version = slot[0].load( std::memory_order_acquire);
+	if( version != 2 * sequence + 2)
+		return false;
+
+	unsigned long long header = slot[1].load( std::memory_order_relaxed);
+	time = static_cast<long long>( slot[2].load( std::memory_order_relaxed));
+	len = std::min<std::size_t>( header & 0xffffffff, maxLength);
+	for( std::size_t i = 0; i < wordsFor( len); ++i) {
+		unsigned long long word = slot[3 + i].load( std::memory_order_relaxed);
+		std::memcpy( text + 8 * i, &word, std::min<std::size_t>( 8, len - 8 * i));
+	}
+	// the message was complete if the slot was not taken meanwhile
+	std::atomic_thread_fence( std::memory_order_acquire);
+	if( slot[0].load( std::memory_order_relaxed) != version)
+		return false;
+	ll = static_cast<LogLevel>( header >> 32);
+	return true;
+}
+
+captureChainLink::Messages captureChainLink::snapshot() const {
+	Messages messages;
+	std::vector<char> text( maxLength);
+	unsigned long long end = next.load( std::memory_order_acquire);
+	for( unsigned long long sequence = end > capacity ? end - capacity : 0; sequence < end; ++sequence) {
+		Message message;
+		std::size_t len;
+		if( !read( sequence, message.ll, message.time, text.data(), len))
+			continue;
+		message.sequence = sequence;
+		message.text.assign( text.data(), len);
+		messages.push_back( message);
+	}
+	return messages;
+}
+
+void captureChainLink::dump( int fd) const {
+	// the buffer is shared, a dump running on another thread wins
+	if( dumping.test_and_set( std::memory_order_acquire))
+		return;
+
+	unsigned long long end = next.load( std::memory_order_acquire);
+	for( unsigned long long sequence = end > capacity ? end - capacity : 0; sequence < end; ++sequence) {
+		LogLevel ll;
+		long long time;
+		std::size_t len;
+		if( !read( sequence, ll, time, dumpBuffer.get(), len))
+			continue;
+
+		char prefix[2 * LIB::max_chars + 16];
+		char* p = LIB::to_chars( prefix, time / 1000000000);
+		*p++ = '.';
+		char micros[LIB::max_chars];
+		char* microsEnd = LIB::to_chars( micros, time % 1000000000 / 1000 + 1000000);
+		// skip the leading 1 keeping the zeros
+		std::memcpy( p, micros + 1, static_cast<std::size_t>( microsEnd - micros - 1));
+		p += microsEnd - micros - 1;
+		*p++ = ' ';
+		std::size_t levelLength = std::strlen( levelNames[ll]);
+		std::memcpy( p, levelNames[ll], levelLength);
+		p += levelLength;
+		*p++ = ' ';
+
+		char newline = '\n';
+		iovec parts[] = {
+			{ prefix, static_cast<std::size_t>( p - prefix) },
+			{ dumpBuffer.get(), len },
+			{ &newline, 1 }
+		};
+		writeFully( fd, parts, 3);
+	}
+	dumping.clear( std::memory_order_release);
+}
+
+void captureChainLink::dumpOnCrash( int fd) {
+	std::lock_guard<std::mutex> lk(m_crashDumps);
+	for( auto& dump : crashDumps) {
+		if( dump.link.load( std::memory_order_relaxed))
+			continue;
+		dump.fd.store( fd, std::memory_order_relaxed);
+		dump.link.store( this, std::memory_order_release);
+		crashFd = fd;
+		std::call_once( crashHandlersInstalled, [] {
+			for( std::size_t i = 0; i < crashSignalCount; ++i) {
+				struct sigaction action;
+				std::memset( &action, 0, sizeof(action));
+				action.sa_handler = crashHandler;
+				action.sa_flags = SA_ONSTACK;
+				sigemptyset( &action.sa_mask);
+				::sigaction( crashSignals[i], &action, &previousHandlers[i]);
+			}
+		});
+		return;
+	}
+	throw std::invalid_argument("too many capture links registered to dump on crash");
+}
+
+taggingChainLink::taggingChainLink(outputChain* nextLink /* = 0 */, TimeFormat format /* = TF_elapsed */, unsigned digits /* = 3 */)
+: outputChain( LL_debug, true, nextLink)
+, format( format)
+, digits( digits) {
+	// nothing is written by the link itself
+	setThreadSafe( true);
+	setForwarding( true);
+	resetTime();
 }
 
 void taggingChainLink::resetTime() {
-	m_tp = std::chrono::system_clock::now();
+	m_tp.store( LogClock::now(), std::memory_order_relaxed);
+}
+
+void taggingChainLink::log( const LogRecord& rec) {
+	char prefix[LogClock::maxFormatted + 1];
+	char* end = LogClock::format( prefix, rec.time(), format, digits, m_tp.load( std::memory_order_relaxed));
+	*end++ = ' ';
+
+	outputChain::log( LogRecord( rec, prefix, static_cast<std::size_t>(end - prefix)));
+}
+
+
+int taggingChainLink::mostVerbose( int first) const {
+	return nextVerbose( first);
 }
 
-void taggingChainLink::log( LogLevel ll, const std::string& str) {
-	auto tp = std::chrono::system_clock::now();
-	auto t = tp - m_tp;
-	auto s = std::chrono::duration_cast<std::chrono::seconds>(t);
-	auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(t % std::chrono::seconds(1));
+rateLimitingChainLink::rateLimitingChainLink( double messagesPerSecond, unsigned burst, outputChain* nextLink /* = 0 */,
+		std::chrono::milliseconds summaryInterval /* = 1000ms */, std::size_t buckets /* = 1024 */)
+: outputChain( LL_debug, true, nextLink)
+, buckets( buckets)
+, emissionInterval( static_cast<long long>( 1e9 / messagesPerSecond))
+, burstTolerance( emissionInterval * ( burst ? burst - 1 : 0))
+, summaryInterval( std::chrono::duration_cast<std::chrono::nanoseconds>( summaryInterval).count()) {
+	if( !( messagesPerSecond > 0) || !burst || !buckets)
+		throw std::invalid_argument("rate limit, burst and number of buckets have to be positive");
+	// all state is atomic, and summaries are forwarded from real_flush
+	setThreadSafe( true);
+	setForwarding( true);
+}
+
+rateLimitingChainLink::~rateLimitingChainLink() {
+	real_flush();
+}
 
-	std::ostringstream prep;
-	prep << std::setw(3) << s.count() << "." << std::setw(3) << std::setfill('0') << ms.count() << " " << str;
+void rateLimitingChainLink::log( const LogRecord& rec) {
+	std::uint64_t hash;
+	if( const LogSite* site = rec.site()) {
+		hash = site->id() * 0x9e3779b97f4a7c15ull;
+	} else {
+		// FNV-1a
+		hash = 0xcbf29ce484222325ull;
+		for( char c : rec.text())
+			hash = ( hash ^ static_cast<unsigned char>(c)) * 0x100000001b3ull;
+	}
+	Bucket& bucket = buckets[ hash % buckets.size()];
+	long long now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
 
-	outputChain::log(ll, prep.str());
+	if( allow( bucket, now)) {
+		if( bucket.suppressed.load( std::memory_order_relaxed)) {
+			if( unsigned long long n = bucket.suppressed.exchange( 0, std::memory_order_relaxed))
+				summarize( rec, n);
+		}
+		outputChain::log( rec);
+		return;
+	}
+
+	if( !bucket.suppressed.fetch_add( 1, std::memory_order_relaxed)) {
+		// the summary interval starts with the first suppressed message
+		bucket.lastSummary.store( now, std::memory_order_relaxed);
+		return;
+	}
+	long long last = bucket.lastSummary.load( std::memory_order_relaxed);
+	if( now - last >= summaryInterval
+			&& bucket.lastSummary.compare_exchange_strong( last, now, std::memory_order_relaxed)) {
+		if( unsigned long long n = bucket.suppressed.exchange( 0, std::memory_order_relaxed))
+			summarize( rec, n);
+	}
 }
 
+bool rateLimitingChainLink::allow( Bucket& bucket, long long now) {
+	long long tat = bucket.tat.load( std::memory_order_relaxed);
+	for( ;;) {
+		long long start = std::max( tat, now);
+		if( start - now > burstTolerance)
+			return false;
+		if( bucket.tat.compare_exchange_weak( tat, start + emissionInterval, std::memory_order_relaxed))
+			return true;
+	}
+}
+
+void rateLimitingChainLink::summarize( const LogRecord& rec, unsigned long long n) {
+	MessageBuffer summary;
+	summary.append( "message repeated ", 17);
+	char* first = summary.reserve( LIB::max_chars);
+	summary.commit( LIB::to_chars( first, n));
+	summary.append( " times: ", 8);
+	const std::string& text = rec.text();
+	summary.append( text.data(), text.size());
+	outputChain::log( LogRecord( rec, summary.str()));
+}
+
+void rateLimitingChainLink::real_flush() {
+	unsigned long long n = 0;
+	for( auto& bucket : buckets)
+		n += bucket.suppressed.exchange( 0, std::memory_order_relaxed);
+	if( !n)
+		return;
+
+	MessageBuffer summary;
+	char* first = summary.reserve( LIB::max_chars);
+	summary.commit( LIB::to_chars( first, n));
+	summary.append( " messages suppressed by rate limit", 34);
+	outputChain::log( LogRecord( LL_notice, summary.str()));
+}
+
+int rateLimitingChainLink::mostVerbose( int first) const {
+	return nextVerbose( first);
+}
+
+//! the messages held back by a backtraceChainLink for one thread
+class backtraceChainLink::Backlog {
+public:
+	Backlog( std::size_t depth)
+	: entries( depth)
+	, prefixes( depth)
+	, next( 0)
+	, count( 0) {
+		for( auto& entry : entries)
+			entry.data.reserve( 128);
+	}
+
+	void add( const LogRecord& rec) {
+		// the prefixes of decorating links are kept apart, so a deferred
+		// message is still held back unformatted
+		std::string& prefix = prefixes[next];
+		prefix.clear();
+		const LogRecord* original = &rec;
+		for( ; original->original(); original = original->original())
+			prefix.append( original->prefix(), original->prefixSize());
+
+		LogQueue::Entry& entry = entries[next];
+		entry.ll = original->level();
+		entry.time = original->time();
+		entry.site = original->deferred() ? original->site() : 0;
+		entry.data.assign( original->deferred() ? original->arguments() : original->text());
+		entry.fields.assign( original->fields());
+		next = ( next + 1) % entries.size();
+		count = std::min( count + 1, entries.size());
+	}
+
+	//! the entries held, in a ring starting at next - count
+	std::vector<LogQueue::Entry> entries;
+	//! the prefixes of decorating links in front of the entries
+	std::vector<std::string> prefixes;
+	std::size_t next;
+	std::size_t count;
+};
+
+namespace {
+	//! the backlog of a thread for one backtraceChainLink
+	struct ThreadBacklog {
+		const backtraceChainLink* link;
+		std::shared_ptr<std::atomic<bool>> alive;
+		std::shared_ptr<backtraceChainLink::Backlog> backlog;
+	};
+
+	thread_local std::vector<ThreadBacklog> threadBacklogs;
+} // namespace
+
+backtraceChainLink::backtraceChainLink( std::size_t depth, LogLevel triggerLL /* = LL_error */, outputChain* nextLink /* = 0 */)
+: outputChain( LL_debug, true, nextLink)
+, depth( depth)
+, triggerLL( triggerLL)
+, alive( std::make_shared<std::atomic<bool>>( true)) {
+	if( !depth)
+		throw std::invalid_argument("backtrace link needs to hold at least one message");
+	// nothing is written by the link itself
+	setThreadSafe( true);
+	setForwarding( true);
+}
+
+backtraceChainLink::~backtraceChainLink() {
+	alive->store( false, std::memory_order_relaxed);
+}
+
+backtraceChainLink::Backlog& backtraceChainLink::threadBacklog() {
+	for( auto& entry : threadBacklogs) {
+		if( entry.link == this && entry.alive == alive)
+			return *entry.backlog;
+	}
+
+	// forget the backlogs of destroyed links first
+	threadBacklogs.erase( std::remove_if( threadBacklogs.begin(), threadBacklogs.end(),
+		[]( const ThreadBacklog& entry) { return !entry.alive->load( std::memory_order_relaxed); }), threadBacklogs.end());
+	ThreadBacklog entry = { this, alive, std::make_shared<Backlog>( depth) };
+	threadBacklogs.push_back( entry);
+	return *entry.backlog;
+}
+
+void backtraceChainLink::log( const LogRecord& rec) {
+	Backlog& backlog = threadBacklog();
+	if( rec.level() > triggerLL) {
+		backlog.add( rec);
+		return;
+	}
+
+	std::size_t size = backlog.entries.size();
+	for( std::size_t i = size - backlog.count; i < size; ++i) {
+		std::size_t index = ( backlog.next + i) % size;
+		const LogQueue::Entry& entry = backlog.entries[index];
+		const std::string* fields = entry.fields.empty() ? 0 : &entry.fields;
+		if( entry.site)
+			replay( LogRecord( entry.ll, *entry.site, entry.data, entry.time, fields), backlog.prefixes[index]);
+		else
+			replay( LogRecord( entry.ll, entry.data, fields, entry.time), backlog.prefixes[index]);
+	}
+	backlog.count = 0;
+	outputChain::log( rec);
+}
+
+void backtraceChainLink::replay( const LogRecord& original, const std::string& prefix) {
+	if( prefix.empty())
+		outputChain::log( original);
+	else
+		outputChain::log( LogRecord( original, prefix.data(), prefix.size()));
+}
+
+int backtraceChainLink::mostVerbose( int first) const {
+	return nextVerbose( first);
+}
+
+namespace {
+	long long steadyNs() {
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	template<class T>
+	void appendMetric( MessageBuffer& out, const char* name, std::size_t link, T value) {
+		char* first = out.reserve( std::strlen( name) + 2 * LIB::max_chars + 8);
+		char* end = first;
+		*end++ = ' ';
+		if( link) {
+			end = std::copy( "link", "link" + 4, end);
+			end = LIB::to_chars( end, link);
+			*end++ = '.';
+		}
+		end = std::copy( name, name + std::strlen( name), end);
+		*end++ = '=';
+		out.commit( LIB::to_chars( end, value));
+	}
+
+	unsigned long long total( const unsigned long long* counters) {
+		unsigned long long sum = 0;
+		for( std::size_t i = 0; i < logLevels; ++i)
+			sum += counters[i];
+		return sum;
+	}
+} // namespace
+
+metricsChainLink::metricsChainLink( std::chrono::milliseconds interval, LogLevel metricsLL /* = LL_info */, outputChain* nextLink /* = 0 */)
+: outputChain( LL_debug, true, nextLink)
+, interval( std::chrono::duration_cast<std::chrono::nanoseconds>( interval).count())
+, metricsLL( metricsLL)
+, nextReport( steadyNs() + this->interval) {
+	// nothing is written by the link itself
+	setThreadSafe( true);
+	setForwarding( true);
+}
+
+void metricsChainLink::log( const LogRecord& rec) {
+	long long now = steadyNs();
+	long long next = nextReport.load( std::memory_order_relaxed);
+	if( now >= next && nextReport.compare_exchange_strong( next, now + interval, std::memory_order_relaxed))
+		report();
+	outputChain::log( rec);
+}
+
+void metricsChainLink::report() {
+	Log* log = owningLog();
+	if( !log)
+		return;
+
+	LogMetrics metrics = log->metrics();
+	MessageBuffer out;
+	out.append( "metrics", 7);
+	appendMetric( out, "logged", 0, total( metrics.logged));
+	appendMetric( out, "dropped", 0, total( metrics.dropped));
+	appendMetric( out, "queue_high_water", 0, metrics.queueHighWater);
+	for( std::size_t i = 0; i < metrics.links.size(); ++i) {
+		const LinkMetrics& link = metrics.links[i];
+		appendMetric( out, "written", i + 1, total( link.written));
+		appendMetric( out, "filtered", i + 1, total( link.filtered));
+		appendMetric( out, "bytes", i + 1, link.bytes);
+		appendMetric( out, "write_us", i + 1, std::chrono::duration_cast<std::chrono::microseconds>( link.writeTime).count());
+		appendMetric( out, "lock_wait_us", i + 1, std::chrono::duration_cast<std::chrono::microseconds>( link.lockWait).count());
+	}
+	outputChain::log( LogRecord( metricsLL, out.str()));
+}
+
+int metricsChainLink::mostVerbose( int first) const {
+	return nextVerbose( first);
+}
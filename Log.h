@@ -3,12 +3,24 @@
 
 #include "LogWriter.h"
 #include "LogLevel.h"
+#include "LogRecord.h"
+#include "LogClock.h"
+#include "LogContext.h"
+#include "LogMetrics.h"
+#include "LogQueue.h"
+#include "Rcu.h"
 
-#include <fstream>
+#include <condition_variable>
+#include <map>
+#include <string>
 #include <vector>
 #include <utility>
 #include <mutex>
 #include <chrono>
+#include <thread>
+#include <atomic>
+#include <memory>
+#include <cstddef>
 
 /*!
  * \file Log.h
@@ -19,6 +31,8 @@
 
 
 class outputChain;
+//! the links reached by messages of each log level, see Log::setOutputChain()
+class LogDispatch;
 
 //! basic logging facility
 /*!
@@ -39,12 +53,15 @@ class outputChain;
  * Logging with Log should be threadsafe, as long as the output links are written in an threadsafe
  * manner. Thread safety in Log is achieved through buffering a log message in a temporary until
  * the whole log message is known. The temporary logs the held log message on destruction.
- * The logging section for this buffered message is guarded to only allow on
- * message being logged at any given time.
- * While logging is threadsafe, switching the output chain is (ATM) not! But threadsafety could
- * be provided by implementing some sort of RCU, providing a buffer for the new chain,
- * which only overrides the current chain if no thread is writing at that moment (e.g. atomic
- * counter at the beginning of log)
+ * Log itself takes no lock while writing the message to the output chain. Each output
+ * link guards its own target, so messages to independent targets are written in parallel
+ * (see outputChain::setThreadSafe).
+ * Switching the output chain is threadsafe too. The new chain is published atomically,
+ * the old chain is deleted as soon as no thread is writing to it anymore (see Rcu).
+ *
+ * setOutputChain() flattens the chain into a table holding, for each log level,
+ * the links a message of that level reaches, so writing a message does not
+ * walk the whole chain. The table is rebuilt when the log level of a link changes.
  *
  * \code
  * setOutputChain( new link1(..., new link2(...)));
@@ -55,11 +72,41 @@ class outputChain;
  * logger.message(LL_info) << "log message with log level info";
  * \endcode
  *
+ * Log remembers the most verbose log level any output link writes. Messages
+ * which are more verbose get a disabled LogWriter, which does not format its
+ * arguments. LOG_MESSAGE additionally skips evaluating the arguments.
+ *
+ * By default the output chain is called on the thread destroying the LogWriter.
+ * After startAsync() the LogWriter only queues the finished message and a
+ * background thread owned by Log writes it to the output chain, so slow output
+ * links (files, syslog) do not stall the logging threads.
+ * \code
+ * logger.startAsync( 4096, OP_dropByLevel, LL_info);
+ * \endcode
+ *
+ * On latency critical threads LOG_DEFERRED avoids formatting altogether. It
+ * only copies the arguments, the message is formatted by the first output
+ * link needing the text, in asynchronous mode on the background thread.
+ * binaryFileChainLink writes such messages without ever formatting them.
+ * \code
+ * LOG_DEFERRED( logger, LL_info, "order {} filled at {}", id, price);
+ * \endcode
+ *
+ * Subsystems log through named child loggers, which write to the output
+ * chain of their root but have a log level of their own. Names are separated
+ * by dots, a child without a log level set inherits the one of the closest
+ * parent which has one. The check of a disabled message stays a single load.
+ * \code
+ * Log& http = logger.child( "net.http");
+ * logger.setLevel( "net", LL_debug);	// net.http too
+ * \endcode
+ *
  * \sa LogWriter
  * \sa outputChain
  */
 class Log {
 	friend class LogWriter;
+	friend class outputChain;
 public:
 	Log();
 	/*!
@@ -76,23 +123,218 @@ public:
 	 */
 	LogWriter message( LogLevel ll);
 
+	//! log a message with a log level known at compile time
+	/*!
+	 * Like message( LogLevel), but for log levels more verbose than
+	 * LOG_COMPILED_LEVEL a NullLogWriter is returned, so the
+	 * message does not cost anything at runtime.
+	 * \code
+	 * logger.message<LL_debug>() << "only in debug builds";
+	 * \endcode
+	 */
+	template<LogLevel ll>
+	typename StaticLogWriter<ll>::type message() {
+		return staticMessage( ll, static_cast<typename StaticLogWriter<ll>::type*>(0));
+	}
+
+	//! log a message formatted later, use LOG_DEFERRED instead
+	/*!
+	 * The arguments are encoded into a binary record (see LogArguments),
+	 * the format string is taken from site.
+	 */
+	template<class... Args>
+	void deferred( LogLevel ll, const LogSite& site, const char* /* format */, const Args&... args) {
+		if( !enabled( ll))
+			return;
+		long long time = LogClock::now();
+		MessageBuffer arguments;
+		const LogContext* context = LogContext::current();
+		if( context)
+			LogArguments::encodePrefix( arguments, context->prefix());
+		int expand[] = { 0, ( LogArguments::encode( arguments, args), 0)... };
+		(void)expand;
+		log( LogRecord( ll, site, arguments.str(), time, context && context->fields().size() ? &context->fields() : 0));
+	}
+
+	//! check if any output link would write a message with the given log level
+	bool enabled( LogLevel ll) const {
+		return ll <= level.load( std::memory_order_relaxed);
+	}
+
+	//! the child logger with the given name, created on the first call
+	/*!
+	 * The child writes to the output chain of the root Log and lives as long
+	 * as the root. flush(), metrics() and the asynchronous mode are the ones
+	 * of the root. Called on a child, name is relative to it.
+	 *
+	 * \param name the name of the child, parts separated by dots like "net.http"
+	 */
+	Log& child( const std::string& name);
+
+	//! the name of a child logger, empty for a root Log
+	const std::string& name() const { return m_name; }
+
+	//! limit the messages of this Log, or the children under prefix, to ll
+	/*!
+	 * Applies to all children whose name starts with the parts of prefix,
+	 * log levels set on them before are removed. Messages are still only
+	 * written by the output links whose log level they reach.
+	 *
+	 * \param prefix the name of the children relative to this Log, empty
+	 * 	for this Log and all its children
+	 * \param ll the most verbose log level to write
+	 */
+	void setLevel( const std::string& prefix, LogLevel ll);
+
+	//! let this Log, or the children under prefix, inherit their log level again
+	void resetLevel( const std::string& prefix);
+
 	//! specifiy to which media the output should be written
 	/*!
 	 * When calling setOutputChain the ownership of the outputChain
 	 * is transferred to the Log object. It will take care of the destruction
 	 * of the outputChain.
+	 *
+	 * Other threads may log while the chain is replaced. Messages are
+	 * written either to the old or to the new chain, setOutputChain returns
+	 * after all threads finished writing to the old chain and it was deleted.
+	 * Must not be called from an output link.
 	 */
 	void setOutputChain( outputChain* output);
 
+	//! replaces the output chain and all log levels at once
+	/*!
+	 * Like setOutputChain( output) followed by resetLevel( "") and setLevel()
+	 * for each of levels in order, but no message sees the levels in between.
+	 */
+	void setOutputChain( outputChain* output, const std::vector<std::pair<std::string, LogLevel>>& levels);
+
+	//! write messages to the output chain from a background thread
+	/*!
+	 * After this call LogWriter objects only put their message into a bounded
+	 * queue of their thread, a background thread takes the messages from the
+	 * queues of all threads in the order they were logged and writes them to
+	 * the output chain.
+	 * Should not be called while other threads are logging.
+	 *
+	 * \param capacity the number of messages the queue of each thread can hold
+	 * \param policy what to do with a message if the queue is full
+	 * \param dropLL with OP_dropByLevel, messages with this or a less severe
+	 * 	log level are dropped if the queue is full
+	 */
+	void startAsync( std::size_t capacity, OverflowPolicy policy = OP_block, LogLevel dropLL = LL_info);
+
+	//! write all queued messages and return to synchronous logging
+	/*!
+	 * Should not be called while other threads are logging.
+	 */
+	void stopAsync();
+
+	//! wait until all messages logged before this call were written
+	/*!
+	 * In synchronous mode messages are written before LogWriter is destroyed,
+	 * so this only has to wait in asynchronous mode. Afterwards the output chain
+	 * is flushed, so links collecting messages write them out.
+	 */
+	void flush();
+
+	//! number of messages dropped because the asynchronous queue was full
+	std::size_t droppedMessages() const;
+
+	//! the counters of this Log and of the links of its output chain
+	/*!
+	 * The counters are kept with relaxed atomic operations while logging,
+	 * so taking a snapshot does not stop other threads. Messages of log
+	 * levels no link would write are not counted, to keep the check of
+	 * enabled() a single load.
+	 */
+	LogMetrics metrics() const;
+
 private:
-	//! send a log message to the output links
-	void log( LogLevel ll, const std::string& str);
-	//! the current output chain
-	outputChain* output;
-	//! synchronize log messages
-	std::mutex m_m;
+	//! overloads selecting the writer for message<LogLevel>()
+	LogWriter staticMessage( LogLevel ll, LogWriter*) { return message( ll); }
+	NullLogWriter staticMessage( LogLevel, NullLogWriter*) { return NullLogWriter(); }
+
+	//! send a log message to the output links, or queue it in asynchronous mode
+	void log( const LogRecord& rec);
+	//! write a log message to the output links
+	void dispatch( const LogRecord& rec);
+	//! body of the background thread in asynchronous mode
+	void asyncWorker();
+	//! a child of root
+	Log( Log* root, const std::string& name);
+
+	//! recalculate level and the dispatch table from the log levels of the output chain
+	void updateLevel();
+	//! set level of the root and its children, holding m_config
+	void applyLevels();
+	//! the log level set for the child name or its closest parent, holding m_config
+	LogLevel configuredLevel( const std::string& name) const;
+	//! removes the levels set for prefix and its children, holding m_config
+	void eraseLevels( const std::string& prefix);
+	//! the full name of the child prefix of this Log
+	std::string childName( const std::string& prefix) const;
+	//! installs output, and the levels replacing all levels set unless 0
+	void replaceChain( outputChain* output, const std::vector<std::pair<std::string, LogLevel>>* levels);
+	//! delete a replaced dispatch table, once no thread can use it anymore
+	void retire( LogDispatch* old);
+	//! the current output chain, replaced by RCU
+	std::atomic<outputChain*> output;
+	//! the flattened output chain, replaced by RCU together with output
+	std::atomic<LogDispatch*> table;
+	//! tables replaced while the calling thread held a ReadLock, deleted by setOutputChain
+	std::vector<LogDispatch*> retired;
+	//! serializes setOutputChain and updateLevel
+	std::mutex m_config;
+	//! most verbose log level written by the output chain, -1 if none
+	std::atomic<int> level;
+	//! message queue in asynchronous mode, 0 otherwise
+	LogQueue* queue;
+	//! thread writing the queued messages
+	std::thread worker;
+	//! messages dropped by queues of previous asynchronous phases
+	std::size_t droppedBefore;
+	//! queue high water mark of previous asynchronous phases
+	std::size_t highWaterBefore;
+	//! messages passed to the output chain or queued, by log level
+	ThreadLevelCounters logged;
+	//! messages dropped by the queue, by log level
+	LevelCounters dropped;
+
+	//! the Log a child writes to, 0 for the root
+	Log* root;
+	//! see name()
+	const std::string m_name;
+	//! the children of the root, by name
+	std::map<std::string, std::unique_ptr<Log>> children;
+	//! the log levels set with setLevel(), by name
+	std::map<std::string, LogLevel> levels;
+	//! most verbose log level written by the output chain, -1 if none
+	int chainLevel;
 };
 
+//! log a message which is formatted later, if at all
+/*!
+ * \code
+ * LOG_DEFERRED( logger, LL_info, "connected to {} port {}", host, port);
+ * \endcode
+ * The format string has to be a string literal, each {} is replaced by the
+ * next argument. Numbers, characters, strings and pointers are copied in
+ * binary form, other types are converted with LIB::stringify immediately.
+ * Like LOG_MESSAGE, the arguments are only evaluated if the message will
+ * be written.
+ */
+#define LOG_DEFERRED( log, ll, ...) \
+	do { \
+		if( (ll) <= LOG_COMPILED_LEVEL && (log).enabled( ll)) { \
+			static LogSite log_deferred_site( LOG_DEFERRED_FORMAT( __VA_ARGS__, 0), __FILE__, __LINE__); \
+			(log).deferred( ll, log_deferred_site, __VA_ARGS__); \
+		} \
+	} while( 0)
+
+//! helper for LOG_DEFERRED, selects the format string
+#define LOG_DEFERRED_FORMAT( format, ...) format
+
 //! a logger which can be used application wide provided for ease of use
 //! if needed, others can be instanciated
 extern Log logger;
@@ -103,10 +345,16 @@ extern Log logger;
  * It provides a non virtual interface (NVI) to overload.
  * 
  * Every output link object has to override real_log. That function should write
- * the specified log message to the given facility.
+ * the specified log message to the given facility. Links which want more than
+ * the text of the message override real_logRecord instead.
+ *
+ * Calls to real_log of one link are serialized by a mutex of the link, so
+ * real_log does not have to be threadsafe. Links whose target does its own
+ * synchronization can call setThreadSafe() to skip that mutex.
  */
 class outputChain {
 	friend class Log;
+	friend class LogDispatch;
 public:
 	/*!
 	 * Create the output link with the specified minimal log level.
@@ -135,14 +383,28 @@ public:
 
 	//! retrieve the minimum log level
 	LogLevel logLevel() const;
+
+	//! write out messages held back by this or one of the following links
+	void flush();
+
+	//! the counters of this link
+	LinkMetrics metrics() const;
+
+	//! measure the time spent writing and waiting for the mutex of the link
+	/*!
+	 * Applies to this and all following links. Off by default, since it
+	 * reads the clock three times for every message written.
+	 */
+	void setTimed( bool timed);
+
 	virtual ~outputChain();
 protected:
 	//! NVI for logging a message
 	/*! For normal chain links this method should not be touched,
 	 *  only in special cases and with care should this method
-	 *  be overridden.
+	 *  be overridden. Links overriding it have to call setForwarding().
 	 */
-	virtual void log( LogLevel ll, const std::string& str);
+	virtual void log( const LogRecord& rec);
 
 	//! method which should be overloaded by concrete links 
 	/*!
@@ -150,13 +412,102 @@ protected:
 	 * \param str log message which should be written
 	 */
 	virtual void real_log( LogLevel ll, const std::string& str) = 0;
+
+	//! called instead of real_log, by default calls real_log with the text of rec
+	/*!
+	 * Links which do not need the formatted text of deferred messages
+	 * can override this method.
+	 */
+	virtual void real_logRecord( const LogRecord& rec);
+
+	//! method which should be overloaded by links holding back messages
+	/*!
+	 * Called like real_log, but without a message. Should write out all
+	 * messages the link held back so far.
+	 */
+	virtual void real_flush() {}
+
+	//! calls real_logRecord, holding the mutex of the link unless it is threadsafe
+	void write( const LogRecord& rec);
+
+	//! calls real_flush of this link only, locking like write()
+	void flushLink();
+
+	//! the mutex held while real_log and real_flush are called
+	/*!
+	 * Allows links to modify their state from other threads.
+	 */
+	std::mutex& linkMutex() { return m_m; }
+
+	//! count bytes written by a link
+	/*!
+	 * The text written by real_log is counted by real_logRecord, links
+	 * overriding real_logRecord count what they write themselves.
+	 */
+	void countBytes( std::size_t len) { bytesWritten.fetch_add( len, std::memory_order_relaxed); }
+
+	//! the Log the link belongs to, 0 while it is not part of an output chain
+	Log* owningLog() const { return owner; }
+
+	//! declare that real_log may be called by several threads at once
+	/*!
+	 * Should be called in the constructor of the link.
+	 */
+	void setThreadSafe( bool threadSafe);
+
+	//! declare that the link overrides log()
+	/*!
+	 * Log then calls log() of the link instead of deciding itself which of
+	 * the following links a message reaches. Should be called in the
+	 * constructor of the link.
+	 */
+	void setForwarding( bool forwarding);
+
+	//! most verbose log level written by this or one of the following links
+	/*!
+	 * Links which override log() and do not write messages themselves have
+	 * to override this method too.
+	 *
+	 * \param first the most severe log level reaching this link,
+	 * 	all less severe levels reach the link too
+	 * \return the log level, or -1 if no message would be written
+	 */
+	virtual int mostVerbose( int first) const;
+
+	//! most verbose log level written by the following links
+	/*!
+	 * \param first the most severe log level reaching this link
+	 */
+	int nextVerbose( int first) const;
 private:
 	//! save if log message should be propagated to next link object
 	bool doPropagate;
 	//! next link object
 	outputChain* nextLink;
 	//! minimal log level which should be logged
-	LogLevel minimumLL;
+	std::atomic<LogLevel> minimumLL;
+	//! the Log this link belongs to, informed about log level changes
+	Log* owner;
+	//! true if real_log does its own synchronization
+	bool threadSafe;
+	//! true if the link overrides log()
+	bool forwarding;
+	//! the flattened following links of a forwarding link, 0 if not known
+	std::atomic<const LogDispatch*> following;
+
+	//! write() measuring the time of writing and locking
+	void timedWrite( const LogRecord& rec);
+
+	//! messages written and filtered by this link, by log level
+	LevelCounters writtenByLevel;
+	LevelCounters filteredByLevel;
+	std::atomic<unsigned long long> bytesWritten;
+	//! nanoseconds spent in real_logRecord and waiting for m_m
+	std::atomic<long long> writeTime;
+	std::atomic<long long> lockWait;
+	std::atomic<bool> timed;
+	//! serializes calls to real_log
+	std::mutex m_m;
 };
 
 //! an output link writing to std::cout
@@ -166,6 +517,7 @@ public:
 	~coutChainLink();
 protected:
 	void real_log( LogLevel ll, const std::string& str);
+	void real_logRecord( const LogRecord& rec);
 };
 
 //! an output link writing to std::cerr
@@ -175,9 +527,20 @@ public:
 	~cerrChainLink();
 protected:
 	void real_log( LogLevel ll, const std::string& str);
+	void real_logRecord( const LogRecord& rec);
 };
 
 //! an output link writing to a file
+/*!
+ * By default every message is written to the file with one system call
+ * before real_log returns. For high message rates setBuffering() lets the
+ * link collect messages in memory and write them in batches.
+ *
+ * setRotation() lets the link start a new file when the current one got too
+ * large or old. Renaming, opening and compressing files is done by a
+ * background thread, logging threads are only held up while the new file
+ * descriptor is swapped in.
+ */
 class fileChainLink : public outputChain {
 public:
 	/*!
@@ -198,12 +561,235 @@ public:
 	 */
 	fileChainLink( const std::string& filename, bool overrideFile, LogLevel minimumLL, bool doPropagate = 1, outputChain* nextLink = 0);
 	~fileChainLink();
+
+	//! collect messages in memory and write them in batches
+	/*!
+	 * Collected messages are written when the next message does not fit into
+	 * the buffer anymore, at least every interval, when the link or Log is
+	 * flushed, and together with every message of flushLL or more severe.
+	 * Should be called before the link is used for logging.
+	 *
+	 * \param bufferSize number of characters to collect, 0 to write every message immediately
+	 * \param interval the maximum time messages are held back, 0 to only write on the other events
+	 * \param flushLL messages with this or a more severe log level are written immediately
+	 */
+	void setBuffering( std::size_t bufferSize, std::chrono::milliseconds interval = std::chrono::milliseconds(1000), LogLevel flushLL = LL_error);
+
+	//! start a new file when the current one gets too large or too old
+	/*!
+	 * On rotation the file is renamed to filename.1, an existing filename.1
+	 * to filename.2 and so on, files beyond keep are deleted. Rotation happens
+	 * shortly after the file reached maxBytes, so it may get a bit larger.
+	 * Should be called before the link is used for logging.
+	 *
+	 * \param maxBytes rotate when the file reached this size, 0 for no size limit
+	 * \param interval rotate after this time, 0 for no time limit
+	 * \param keep the number of rotated files to keep
+	 * \param compress gzip rotated files to filename.1.gz etc., throws
+	 * 	std::invalid_argument if the library was built without zlib
+	 */
+	void setRotation( unsigned long long maxBytes, std::chrono::seconds interval, unsigned keep, bool compress = false);
+
+	//! the number of times the file was rotated
+	/*!
+	 * Messages logged after this count went up are written to the new file.
+	 */
+	std::size_t rotations() const { return rotationCount.load(); }
 protected:
-	std::ofstream file;
+	//! the name of the log file
+	std::string filename;
+	//! the file descriptor of the log file
+	int fd;
+	//! messages not yet written
+	std::string buffer;
+	//! number of characters to collect before writing, 0 if not buffering
+	std::size_t bufferSize;
+	//! messages this severe are written immediately
+	LogLevel flushLL;
+	//! bytes written to the current file
+	unsigned long long written;
+
 	void real_log( LogLevel ll, const std::string& str);
+	//! writes the segments of the message without joining them
+	void real_logRecord( const LogRecord& rec);
+	void real_flush();
+
+	//! to be called by subclasses after appending a message to buffer
+	/*!
+	 * Writes the buffer if needed and starts rotating the file when it
+	 * got too large.
+	 *
+	 * \param ll the log level of the message
+	 * \param len the number of characters appended
+	 */
+	void appended( LogLevel ll, std::size_t len);
+private:
+	//! writes or buffers a message of len characters in count parts
+	void writeMessage( LogLevel ll, const iovec* parts, std::size_t count, std::size_t len);
+	//! writes the buffer followed by a message in count parts and a newline
+	void writeOut( const iovec* message, std::size_t count);
+	//! adds len to written, requesting rotation if needed
+	void countWritten( std::size_t len);
+	//! starts the background thread if it is not running yet
+	void startBackground();
+	//! body of the thread writing the buffer and rotating files
+	void background();
+	//! moves the current file away and continues with a new one
+	void rotate();
+	//! name of the n-th rotated file
+	std::string rotatedName( unsigned n, bool compressed) const;
+
+	std::chrono::milliseconds flushInterval;
+	std::chrono::steady_clock::time_point nextFlush;
+
+	unsigned long long maxBytes;
+	std::chrono::seconds rotationInterval;
+	std::chrono::steady_clock::time_point nextRotation;
+	unsigned keep;
+	bool compress;
+	//! set by real_log when the file got too large
+	bool rotateRequested;
+	std::atomic<std::size_t> rotationCount;
+
+	std::thread worker;
+	std::thread compressor;
+	std::mutex m_background;
+	std::condition_variable wakeBackground;
+	bool stopping;
+};
+
+//! an output link writing messages and their fields as JSON lines
+/*!
+ * Every message is written as one JSON object per line, holding the log
+ * level, the message text and the key/value fields added with
+ * LogWriter::kv():
+ * \code
+ * {"level":"info","message":"request done","user":42,"latency_us":17.5}
+ * \endcode
+ * The object is serialized directly into the buffer of fileChainLink, so
+ * buffering and rotation work like for plain text files.
+ */
+class jsonFileChainLink : public fileChainLink {
+public:
+	/*!
+	 * \param filename the file to open and write to
+	 * \param overrideFile determinte wheter the file should be overwritten or be appended to
+	 * \param minimumLL the minimal log level which should be logged
+	 * \param doPropagate determine wheter the next logger should be called if 
+	 * 	the message was logged
+	 * \param nextLink the next output link
+	 */
+	jsonFileChainLink( const std::string& filename, bool overrideFile, LogLevel minimumLL, bool doPropagate = 1, outputChain* nextLink = 0);
+protected:
+	void real_logRecord( const LogRecord& rec);
+};
+
+//! an output link writing to a memory mapped file used as ring buffer
+/*!
+ * The file holds the last messages that fit into its fixed size. Writing a
+ * message only copies it into the mapped memory, no system calls are made.
+ * Since the kernel writes the mapped pages back to the file, the messages
+ * logged before a crash of the process can be read from the file afterwards,
+ * with readMessages() or the logring_dump tool.
+ *
+ * Every record is tagged with its position in the stream of all records, so
+ * the reader can tell current records from overwritten ones.
+ */
+class ringFileChainLink : public outputChain {
+public:
+	typedef std::vector<std::pair<LogLevel, std::string>> Messages;
+
+	/*!
+	 * Create the output link with the specified minimal log level.
+	 * Also specify wheter the message should be propageted to the next link.
+	 * If doPropagate is set to false, Log will stop calling links after this link
+	 * wrote the log message. 
+	 * nextLink is used to concatenate the list of output links, the ownership of a
+	 * supplied 'child' goes over to the output object. It will handle destruction
+	 * of the supplied object.
+	 *
+	 * An existing ring file of the same capacity is continued, other files are overwritten.
+	 * Links mapping the same file share its write position.
+	 *
+	 * \param filename the file to map
+	 * \param capacity number of bytes available for messages, messages longer than
+	 * 	a quarter of it are truncated
+	 * \param minimumLL the minimal log level which should be logged
+	 * \param doPropagate determine wheter the next logger should be called if 
+	 * 	the message was logged
+	 * \param nextLink the next output link
+	 */
+	ringFileChainLink( const std::string& filename, std::size_t capacity, LogLevel minimumLL, bool doPropagate = 1, outputChain* nextLink = 0);
+	~ringFileChainLink();
+
+	//! read the messages of a ring file, oldest first
+	/*!
+	 * May be used on the file of a running or crashed process.
+	 */
+	static Messages readMessages( const std::string& filename);
+protected:
+	void real_log( LogLevel ll, const std::string& str);
+private:
+	//! the mapped file
+	char* map;
+	//! size of the mapped file
+	std::size_t mapSize;
+	//! number of bytes available for records
+	std::size_t capacity;
+};
+
+//! an output link writing messages in binary form to a file
+/*!
+ * Messages of LOG_DEFERRED are written as call site id and encoded
+ * arguments, so they are never formatted by the logging process. The format
+ * string and source location of each call site are written once, before its
+ * first message. Other messages are written as text.
+ *
+ * The file is turned into text with readMessages() or the logbin_decode tool.
+ */
+class binaryFileChainLink : public outputChain {
+public:
+	typedef std::vector<std::pair<LogLevel, std::string>> Messages;
+
+	/*!
+	 * Create the output link with the specified minimal log level.
+	 * Also specify wheter the message should be propageted to the next link.
+	 * If doPropagate is set to false, Log will stop calling links after this link
+	 * wrote the log message. 
+	 * nextLink is used to concatenate the list of output links, the ownership of a
+	 * supplied 'child' goes over to the output object. It will handle destruction
+	 * of the supplied object.
+	 *
+	 * An existing binary log file is continued, other files are overwritten.
+	 * Call sites are written again before their first message of this link.
+	 *
+	 * \param filename the file to write
+	 * \param minimumLL the minimal log level which should be logged
+	 * \param doPropagate determine wheter the next logger should be called if 
+	 * 	the message was logged
+	 * \param nextLink the next output link
+	 */
+	binaryFileChainLink( const std::string& filename, LogLevel minimumLL, bool doPropagate = 1, outputChain* nextLink = 0);
+	~binaryFileChainLink();
+
+	//! read and format the messages of a binary log file
+	static Messages readMessages( const std::string& filename);
+protected:
+	void real_log( LogLevel ll, const std::string& str);
+	void real_logRecord( const LogRecord& rec);
+private:
+	int fd;
+	//! the records of the current message
+	std::string record;
+	//! call sites already written to the file, indexed by LogSite::id()
+	std::vector<bool> written;
 };
 
 //! an output link writing to the syslog deamon
+/*!
+ * Uses syslog(), whose openlog() settings are process wide, so only one
+ * syslogChainLink should exist at a time. See syslogSocketChainLink.
+ */
 class syslogChainLink : public outputChain {
 public:
 	/*!
@@ -228,6 +814,76 @@ protected:
 	void real_log( LogLevel ll, const std::string& str);
 };
 
+//! the frame format of syslogSocketChainLink
+enum SyslogFormat {
+	SF_rfc3164,	///< "<PRI>Mmm dd hh:mm:ss identity[pid]: message", as written by syslog()
+	SF_rfc5424	///< "<PRI>1 timestamp hostname identity pid - - message"
+};
+
+//! an output link sending to the syslog daemon without syslog()
+/*!
+ * Writes complete syslog frames to the unix datagram socket of the syslog
+ * daemon. Unlike syslogChainLink every link has its own identity and
+ * connection, so several links do not interfere, and the constant part of
+ * the frame header is formatted once.
+ *
+ * Threads logging while another thread sends add their frames to a batch,
+ * which the sending thread passes to the daemon with a single sendmmsg()
+ * call. The timestamp of a frame is the time the message was logged.
+ */
+class syslogSocketChainLink : public outputChain {
+public:
+	/*!
+	 * \param identity the program name shown by the syslog daemon
+	 * \param minimumLL the minimal log level which should be logged
+	 * \param socketPath the socket of the syslog daemon
+	 * \param format the frame format
+	 * \param facility the syslog facility number, 1 for user level messages
+	 * \param doPropagate determine wheter the next logger should be called if
+	 * 	the message was logged
+	 * \param nextLink the next output link
+	 * \throw std::invalid_argument if the socket can not be connected
+	 */
+	syslogSocketChainLink( const std::string& identity, LogLevel minimumLL, const std::string& socketPath = "/dev/log",
+		SyslogFormat format = SF_rfc3164, int facility = 1, bool doPropagate = 1, outputChain* nextLink = 0);
+	~syslogSocketChainLink();
+protected:
+	void real_log( LogLevel ll, const std::string& str);
+	void real_logRecord( const LogRecord& rec);
+	//! waits until all frames were sent
+	void real_flush();
+private:
+	//! add a frame to the batch, and send the batch unless another thread does
+	/*!
+	 * \return the length of the frame
+	 */
+	std::size_t send( LogLevel ll, long long time, const std::string& str);
+	//! writes the start of the frame up to the identity
+	char* frameStart( char* out, LogLevel ll, long long time) const;
+	//! passes the first count frames of sending to the daemon
+	void sendFrames( std::size_t count);
+	//! opens the socket and connects it to socketPath
+	bool connect();
+
+	const std::string socketPath;
+	const SyslogFormat format;
+	const int facility;
+	//! the part of the header following the timestamp
+	std::string identityPart;
+	int fd;
+
+	//! guards pending, pendingCount and sending
+	std::mutex m_pending;
+	std::condition_variable idle;
+	//! frames waiting to be sent, the first pendingCount are used
+	std::vector<std::string> pending;
+	std::size_t pendingCount;
+	//! true while a thread sends frames
+	bool sending;
+	//! frames being sent, swapped with pending
+	std::vector<std::string> batch;
+};
+
 //! an output link that buffers all log messages that it saw
 /*! It is mainly thought to be used in test code, where we want to verify the
  *  logged message. In normal productive code it should only be used with great
@@ -248,25 +904,288 @@ public:
    //! empties buffer, not threadsafe()
    void clear();
 protected:
+   //! the messages returned by getMessages() so far
    LogBuffer buffer;
+   //! all messages, sharing their text with other links keeping it
+   std::vector<std::pair<LogLevel, LogRecord::SharedText>> shared;
    void real_log( LogLevel ll, const std::string& str);
+   void real_logRecord( const LogRecord& rec);
+};
+
+//! an output link keeping the last messages in memory
+/*!
+ * Unlike bufferingChainLink the memory is allocated once: the link holds
+ * capacity slots of a fixed size, and each message overwrites the oldest
+ * slot. Longer messages are truncated. Appending takes no lock, so
+ * threads logging at once do not wait for each other.
+ *
+ * snapshot() copies the complete messages currently held, oldest first.
+ * dump() writes them to a file descriptor and is async-signal-safe, so it
+ * can be called from a signal handler. dumpOnCrash() installs handlers for
+ * the signals of a faulting process which do so.
+ * \code
+ * captureChainLink* capture = new captureChainLink( 1024, 256, LL_debug);
+ * capture->dumpOnCrash( STDERR_FILENO);
+ * logger.setOutputChain( capture);
+ * \endcode
+ */
+class captureChainLink : public outputChain {
+public:
+	//! a message held by the link
+	struct Message {
+		//! number of the message among all messages written to the link, starting at 0
+		unsigned long long sequence;
+		LogLevel ll;
+		//! when the message was logged, see LogClock::now()
+		long long time;
+		std::string text;
+	};
+	typedef std::vector<Message> Messages;
+
+	/*!
+	 * \param capacity the number of messages held
+	 * \param maxLength the length messages are truncated to
+	 * \param minimumLL the minimal log level which should be logged
+	 * \param doPropagate determine wheter the next logger should be called if
+	 * 	the message was logged
+	 * \param nextLink the next output link
+	 */
+	captureChainLink( std::size_t capacity, std::size_t maxLength, LogLevel minimumLL, bool doPropagate = 1, outputChain* nextLink = 0);
+	~captureChainLink();
+
+	//! the complete messages currently held, oldest first
+	/*!
+	 * May be called while other threads log. Messages being overwritten
+	 * at the time are left out.
+	 */
+	Messages snapshot() const;
+
+	//! write the messages currently held to fd, oldest first
+	/*!
+	 * Every message is written as a line of the time in seconds since the
+	 * epoch, the log level and the text. Async-signal-safe, neither
+	 * allocates memory nor takes locks.
+	 */
+	void dump( int fd) const;
+
+	//! dump the messages to fd if the process gets a fatal signal
+	/*!
+	 * Installs handlers for SIGSEGV, SIGBUS, SIGFPE, SIGILL and SIGABRT,
+	 * which dump all links registered with dumpOnCrash() and then let the
+	 * signal terminate the process. The handlers run on the alternate signal
+	 * stack, if the application set one up with sigaltstack().
+	 *
+	 * \throw std::invalid_argument if too many links are registered
+	 */
+	void dumpOnCrash( int fd);
+protected:
+	void real_log( LogLevel ll, const std::string& str);
+	void real_logRecord( const LogRecord& rec);
+private:
+	//! copy a message into the slot of the next sequence number
+	void append( LogLevel ll, long long time, const std::string& str);
+	//! copy the message with sequence from its slot, false if it is not complete
+	/*!
+	 * \param text receives the text, needs room for maxLength characters
+	 * \param len receives the length of the text
+	 */
+	bool read( unsigned long long sequence, LogLevel& ll, long long& time, char* text, std::size_t& len) const;
+
+	const std::size_t capacity;
+	const std::size_t maxLength;
+	//! words of a slot: version, level and length, time, text
+	const std::size_t slotWords;
+	//! the slots, the version word of a slot is odd while it is written
+	std::unique_ptr<std::atomic<unsigned long long>[]> slots;
+	//! sequence number of the next message
+	std::atomic<unsigned long long> next;
+	//! receives the text of a message in dump(), allocated in advance
+	std::unique_ptr<char[]> dumpBuffer;
+	//! set while dump() uses dumpBuffer
+	mutable std::atomic_flag dumping;
+	//! the file descriptor given to dumpOnCrash(), -1 if not registered
+	int crashFd;
 };
 
 //! time prepending chain link
 /*! Mainly to be used for debugging output, for productive environments
  *  syslogChainLink should most likely be used.
+ *
+ *  The time written is the time the message was logged (see LogRecord::time()),
+ *  either as seconds elapsed since resetTime() or as ISO-8601 date and time.
  */
 class taggingChainLink : public outputChain {
 public:
-	taggingChainLink(outputChain* nextLink = 0);
+	/*!
+	 * \param nextLink the next output link
+	 * \param format how to write the time
+	 * \param digits the number of sub-second digits, 3 for milliseconds
+	 */
+	taggingChainLink(outputChain* nextLink = 0, TimeFormat format = TF_elapsed, unsigned digits = 3);
 	~taggingChainLink() {}
 	
 	void resetTime();
 protected:
-	std::chrono::system_clock::time_point m_tp;
+	//! the time elapsed time is measured from, see LogClock::now()
+	std::atomic<long long> m_tp;
+	const TimeFormat format;
+	const unsigned digits;
 
-	void log(LogLevel ll, const std::string& str);
+	void log( const LogRecord& rec);
 	void real_log(LogLevel /* ll */, const std::string& /* str */) {}
+	void real_logRecord( const LogRecord& /* rec */) {}
+	int mostVerbose( int first) const;
+};
+
+//! rate limiting chain link
+/*!
+ * Forwards messages to the following links only as long as their rate stays
+ * below a limit, so a single call site flooding the log does not saturate
+ * the links behind this one. Messages of LOG_DEFERRED are limited per call
+ * site, other messages per text. Each of them gets a token bucket holding up
+ * to burst messages, refilled with messagesPerSecond.
+ *
+ * Suppressed messages are counted. While a message keeps being suppressed,
+ * a "message repeated N times: ..." summary is forwarded every
+ * summaryInterval, the remaining count is forwarded with the next message
+ * which passes and on flush().
+ *
+ * The buckets live in a fixed size table indexed by a hash of the call site
+ * or text and are updated with atomic operations only, messages sharing a
+ * slot of the table share the limit.
+ * \code
+ * logger.setOutputChain( new rateLimitingChainLink( 100, 10, new fileChainLink( ...)));
+ * \endcode
+ */
+class rateLimitingChainLink : public outputChain {
+public:
+	/*!
+	 * \param messagesPerSecond the sustained rate of messages forwarded per key
+	 * \param burst the number of messages forwarded at once after a quiet phase
+	 * \param nextLink the next output link
+	 * \param summaryInterval how often summaries of suppressed messages are forwarded
+	 * \param buckets number of slots of the table of token buckets
+	 */
+	rateLimitingChainLink( double messagesPerSecond, unsigned burst, outputChain* nextLink = 0,
+		std::chrono::milliseconds summaryInterval = std::chrono::milliseconds(1000), std::size_t buckets = 1024);
+	~rateLimitingChainLink();
+protected:
+	void log( const LogRecord& rec);
+	void real_log(LogLevel /* ll */, const std::string& /* str */) {}
+	void real_logRecord( const LogRecord& /* rec */) {}
+	void real_flush();
+	int mostVerbose( int first) const;
+private:
+	//! state of the messages mapped to one slot of the table
+	struct Bucket {
+		Bucket() : tat( 0), suppressed( 0), lastSummary( 0) {}
+
+		//! theoretical arrival time of the next message, the bucket is full if it is in the past
+		std::atomic<long long> tat;
+		//! messages suppressed since the last summary
+		std::atomic<unsigned long long> suppressed;
+		//! when the last summary was forwarded
+		std::atomic<long long> lastSummary;
+	};
+
+	//! takes a token from bucket if there is one
+	bool allow( Bucket& bucket, long long now);
+	//! forwards a summary of n suppressed messages like rec
+	void summarize( const LogRecord& rec, unsigned long long n);
+
+	std::vector<Bucket> buckets;
+	//! nanoseconds between two messages at the sustained rate
+	long long emissionInterval;
+	//! nanoseconds messages may arrive ahead of the sustained rate
+	long long burstTolerance;
+	long long summaryInterval;
+};
+
+//! backtrace chain link
+/*!
+ * Holds back all messages less severe than triggerLL, keeping the last
+ * depth of them for every thread. When a thread logs a message of triggerLL
+ * or more severe, the messages held back for the thread are forwarded to
+ * the following links, oldest first, followed by the triggering message.
+ * So verbose messages are only written as the context of an error.
+ *
+ * Messages are held back unformatted, in storage reused for the next
+ * messages of the thread. In asynchronous mode all messages are written by
+ * the background thread, and share one backlog.
+ * \code
+ * // info messages always, debug messages only before errors
+ * logger.setOutputChain( new fileChainLink( "app.log", false, LL_info, true,
+ * 	new backtraceChainLink( 32, LL_error, new fileChainLink( "debug.log", false, LL_debug))));
+ * \endcode
+ */
+class backtraceChainLink : public outputChain {
+public:
+	/*!
+	 * \param depth the number of messages held back per thread
+	 * \param triggerLL the least severe log level forwarding the held back messages
+	 * \param nextLink the next output link
+	 */
+	backtraceChainLink( std::size_t depth, LogLevel triggerLL = LL_error, outputChain* nextLink = 0);
+	~backtraceChainLink();
+
+	class Backlog;
+protected:
+	void log( const LogRecord& rec);
+	void real_log( LogLevel /* ll */, const std::string& /* str */) {}
+	//! does not need the text of the messages
+	void real_logRecord( const LogRecord& /* rec */) {}
+	int mostVerbose( int first) const;
+private:
+	//! the backlog of the calling thread, created if needed
+	Backlog& threadBacklog();
+	//! forwards a held back message, behind the prefixes of the decorating links
+	void replay( const LogRecord& original, const std::string& prefix);
+
+	const std::size_t depth;
+	const LogLevel triggerLL;
+	//! cleared when the link is destroyed, so threads drop their backlogs
+	std::shared_ptr<std::atomic<bool>> alive;
+};
+
+//! metrics reporting chain link
+/*!
+ * Forwards the messages to the following links, and every interval a
+ * message with the counters of the Log (see Log::metrics()) like
+ * \code
+ * metrics logged=120 dropped=0 queue_high_water=8 link1.written=120 link1.filtered=0 link1.bytes=5230 ...
+ * \endcode
+ * Counters are totals over all log levels, link numbers count from 1 at
+ * the start of the output chain. Times are given in microseconds and are
+ * only measured after outputChain::setTimed().
+ *
+ * The metrics are written with the next message logged after the interval
+ * passed, so nothing is written while nothing is logged.
+ */
+class metricsChainLink : public outputChain {
+public:
+	/*!
+	 * \param interval the time between two messages with metrics
+	 * \param metricsLL the log level of the messages with metrics
+	 * \param nextLink the next output link
+	 */
+	metricsChainLink( std::chrono::milliseconds interval, LogLevel metricsLL = LL_info, outputChain* nextLink = 0);
+	~metricsChainLink() {}
+
+protected:
+	void log( const LogRecord& rec);
+	void real_log( LogLevel /* ll */, const std::string& /* str */) {}
+	//! does not need the text of the messages
+	void real_logRecord( const LogRecord& /* rec */) {}
+	int mostVerbose( int first) const;
+
+private:
+	//! forward a message with the current metrics
+	void report();
+
+	const long long interval;
+	const LogLevel metricsLL;
+	//! steady clock time of the next report, in nanoseconds
+	std::atomic<long long> nextReport;
 };
 
 #endif // Log_h_
@@ -0,0 +1,191 @@
+#include "LogClock.h"
+#include "stringify.h"
+
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#include <x86intrin.h>
+#define LOG_HAVE_TSC
+#endif
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <stdexcept>
+#include <algorithm>
+#include <cstring>
+
+namespace {
+	std::atomic<ClockSource> clockSource( CS_realtime);
+
+	long long clockNs( clockid_t clock) {
+		timespec ts;
+		::clock_gettime( clock, &ts);
+		return ts.tv_sec * 1000000000ll + ts.tv_nsec;
+	}
+
+	//! difference between CLOCK_REALTIME and CLOCK_MONOTONIC, taken once
+	long long monotonicOffset() {
+		static const long long offset = clockNs( CLOCK_REALTIME) - clockNs( CLOCK_MONOTONIC);
+		return offset;
+	}
+
+#ifdef LOG_HAVE_TSC
+	//! true if the time stamp counter runs at a constant rate in all power states
+	bool invariantTsc() {
+		unsigned eax, ebx, ecx, edx;
+		return __get_cpuid( 0x80000007, &eax, &ebx, &ecx, &edx) && ( edx & ( 1u << 8));
+	}
+
+	//! a reading of the time stamp counter and the time it corresponds to
+	struct TscCalibration {
+		unsigned long long tsc;
+		long long time;
+		double nsPerTick;
+	};
+
+	TscCalibration calibrate() {
+		long long start = clockNs( CLOCK_MONOTONIC);
+		unsigned long long startTsc = __rdtsc();
+		std::this_thread::sleep_for( std::chrono::milliseconds(20));
+		TscCalibration c;
+		c.time = clockNs( CLOCK_MONOTONIC);
+		c.tsc = __rdtsc();
+		c.nsPerTick = static_cast<double>( c.time - start) / static_cast<double>( c.tsc - startTsc);
+		c.time += monotonicOffset();
+		return c;
+	}
+
+	const TscCalibration& tscCalibration() {
+		static const TscCalibration calibration = calibrate();
+		return calibration;
+	}
+
+	long long tscNs() {
+		const TscCalibration& c = tscCalibration();
+		long long ticks = static_cast<long long>( __rdtsc() - c.tsc);
+		return c.time + static_cast<long long>( static_cast<double>(ticks) * c.nsPerTick);
+	}
+#endif
+
+	const long long powersOf10[] = { 1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000 };
+
+	//! writes value right aligned in a field of at least width characters
+	char* padded( char* first, long long value, std::size_t width, char fill) {
+		char digits[LIB::max_chars];
+		char* end = LIB::to_chars( digits, value);
+		std::size_t len = static_cast<std::size_t>(end - digits);
+		for( ; len < width; --width)
+			*first++ = fill;
+		std::memcpy( first, digits, len);
+		return first + len;
+	}
+
+	//! the part of the last timestamp formatted by the thread up to the sub-second digits
+	struct PrefixCache {
+		PrefixCache() : valid( false), second( 0), format( TF_elapsed), since( 0), len( 0) {}
+
+		bool valid;
+		long long second;
+		TimeFormat format;
+		long long since;
+		char prefix[LogClock::maxFormatted];
+		std::size_t len;
+	};
+
+	thread_local PrefixCache prefixCache;
+
+	std::size_t formatPrefix( char* out, long long second, TimeFormat format) {
+		char* end = out;
+		switch( format) {
+		case TF_elapsed:
+			end = padded( out, second, 3, ' ');
+			break;
+		case TF_iso8601: {
+			time_t t = static_cast<time_t>(second);
+			tm date;
+			::gmtime_r( &t, &date);
+			end += ::strftime( out, LogClock::maxFormatted, "%Y-%m-%dT%H:%M:%S", &date);
+			break;
+		}
+		}
+		return static_cast<std::size_t>(end - out);
+	}
+} // namespace
+
+void LogClock::setSource( ClockSource source) {
+	switch( source) {
+	case CS_monotonic:
+		monotonicOffset();
+		break;
+	case CS_tsc:
+#ifdef LOG_HAVE_TSC
+		if( !invariantTsc())
+			throw std::invalid_argument("the time stamp counter of the CPU is not invariant");
+		tscCalibration();
+		break;
+#else
+		throw std::invalid_argument("no time stamp counter on this architecture");
+#endif
+	case CS_realtime:
+	case CS_realtimeCoarse:
+		break;
+	}
+	clockSource.store( source, std::memory_order_relaxed);
+}
+
+ClockSource LogClock::source() {
+	return clockSource.load( std::memory_order_relaxed);
+}
+
+long long LogClock::now() {
+	switch( clockSource.load( std::memory_order_relaxed)) {
+	case CS_realtime:
+		break;
+	case CS_realtimeCoarse:
+#ifdef CLOCK_REALTIME_COARSE
+		return clockNs( CLOCK_REALTIME_COARSE);
+#else
+		break;
+#endif
+	case CS_monotonic:
+		return clockNs( CLOCK_MONOTONIC) + monotonicOffset();
+	case CS_tsc:
+#ifdef LOG_HAVE_TSC
+		return tscNs();
+#else
+		break;
+#endif
+	}
+	return clockNs( CLOCK_REALTIME);
+}
+
+char* LogClock::format( char* out, long long time, TimeFormat format, unsigned digits, long long since /* = 0 */) {
+	if( format == TF_elapsed)
+		time = std::max( time - since, 0ll);
+	long long second = time / 1000000000;
+	long long fraction = time % 1000000000;
+	if( fraction < 0) {
+		fraction += 1000000000;
+		--second;
+	}
+
+	PrefixCache& cache = prefixCache;
+	if( !cache.valid || cache.second != second || cache.format != format || ( format == TF_elapsed && cache.since != since)) {
+		cache.len = formatPrefix( cache.prefix, second, format);
+		cache.second = second;
+		cache.format = format;
+		cache.since = since;
+		cache.valid = true;
+	}
+	std::memcpy( out, cache.prefix, cache.len);
+	out += cache.len;
+
+	digits = std::min( digits, 9u);
+	if( digits) {
+		*out++ = '.';
+		out = padded( out, fraction / powersOf10[ 9 - digits], digits, '0');
+	}
+	if( format == TF_iso8601)
+		*out++ = 'Z';
+	return out;
+}
@@ -0,0 +1,75 @@
+#ifndef LogClock_h_
+#define LogClock_h_
+
+#include <cstddef>
+
+/*!
+ * \file LogClock.h
+ * \ingroup Logging
+ *
+ * This file should not be included directly, as it is provided by Log.h
+ * Provides the clock timestamping log messages and the formatting of
+ * timestamps.
+ */
+
+//! where LogClock::now() takes the time from
+enum ClockSource {
+	CS_realtime,		///< CLOCK_REALTIME, exact but follows adjustments of the system time
+	CS_realtimeCoarse,	///< CLOCK_REALTIME_COARSE, cheapest, resolution of a scheduler tick
+	CS_monotonic,		///< CLOCK_MONOTONIC, never jumps, offset to the system time taken at startup
+	CS_tsc				///< the time stamp counter of the CPU, calibrated against CLOCK_MONOTONIC
+};
+
+//! how taggingChainLink writes the time of a message
+enum TimeFormat {
+	TF_elapsed,		///< seconds since taggingChainLink::resetTime(), like "  12.345"
+	TF_iso8601		///< UTC date and time, like "2024-05-17T08:15:42.123Z"
+};
+
+//! timestamps of log messages
+/*!
+ * Messages are timestamped when they are logged, by the LogWriter returned
+ * from Log::message() or by LOG_DEFERRED, so in asynchronous mode the time
+ * does not depend on when the background thread gets to the message.
+ *
+ * Timestamps are nanoseconds since the unix epoch, whatever the clock
+ * source. One clock source is used by all Log objects of the process, so
+ * timestamps of different logs can be compared.
+ */
+namespace LogClock {
+	//! select the clock source used from now on, CS_realtime by default
+	/*!
+	 * The time stamp counter is calibrated when CS_tsc is selected first,
+	 * which takes about 20 milliseconds.
+	 *
+	 * \throw std::invalid_argument for CS_tsc if the CPU does not have an
+	 * 	invariant time stamp counter
+	 */
+	void setSource( ClockSource source);
+
+	//! the clock source currently used
+	ClockSource source();
+
+	//! the current time in nanoseconds since the unix epoch
+	long long now();
+
+	//! writes a timestamp at out
+	/*!
+	 * The date and the seconds are only formatted when they changed since
+	 * the last timestamp the calling thread formatted, otherwise only the
+	 * sub-second digits are written behind the cached part.
+	 *
+	 * \param out the first character written, needs room for maxFormatted characters
+	 * \param time the timestamp to write, see now()
+	 * \param format how to write the timestamp
+	 * \param digits the number of sub-second digits, 0 to 9
+	 * \param since with TF_elapsed the time the seconds are counted from
+	 * \return the character after the last written one
+	 */
+	char* format( char* out, long long time, TimeFormat format, unsigned digits, long long since = 0);
+
+	//! maximum number of characters written by format()
+	const std::size_t maxFormatted = 64;
+} // namespace LogClock
+
+#endif // LogClock_h_
@@ -0,0 +1,453 @@
+#include "LogConfig.h"
+
+#include <sys/inotify.h>
+#include <sys/eventfd.h>
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+	const char* levelNames[] = { "emerg", "alert", "critical", "error", "warning", "notice", "info", "debug" };
+
+	//! the options each link type accepts
+	struct LinkType {
+		const char* name;
+		const char* options;
+	};
+
+	const LinkType linkTypes[] = {
+		{ "cout", "level propagate" },
+		{ "cerr", "level propagate" },
+		{ "file", "level propagate path append buffer flush_ms flush_level rotate_bytes rotate_s keep compress" },
+		{ "json", "level propagate path append buffer flush_ms flush_level rotate_bytes rotate_s keep compress" },
+		{ "ring", "level propagate path capacity" },
+		{ "binary", "level propagate path" },
+		{ "syslog", "level propagate identity socket format facility" },
+		{ "tagging", "format digits" },
+		{ "ratelimit", "rate burst summary_ms buckets" },
+		{ "backtrace", "depth trigger" },
+		{ "metrics", "interval_ms level" }
+	};
+
+	[[noreturn]] void fail( unsigned line, const std::string& message) {
+		throw std::invalid_argument("log config line " + std::to_string( line) + ": " + message);
+	}
+
+	//! true if key is one of the space separated words of options
+	bool accepts( const char* options, const std::string& key) {
+		std::string words = std::string(" ") + options + " ";
+		return words.find( " " + key + " ") != std::string::npos;
+	}
+
+	void checkOptions( unsigned line, const std::string& keyword, const std::map<std::string, std::string>& options, const char* accepted) {
+		for( auto& option : options) {
+			if( !accepts( accepted, option.first))
+				fail( line, keyword + " has no option " + option.first);
+		}
+	}
+
+	//! typed access to the options of a line
+	class Options {
+	public:
+		Options( const std::map<std::string, std::string>& values, unsigned line)
+		: values( values)
+		, line( line) {}
+
+		bool has( const char* key) const {
+			return values.count( key) != 0;
+		}
+
+		const std::string& text( const char* key) const {
+			auto found = values.find( key);
+			if( found == values.end())
+				fail( line, std::string("missing option ") + key);
+			return found->second;
+		}
+
+		std::string text( const char* key, const char* fallback) const {
+			return has( key) ? text( key) : fallback;
+		}
+
+		unsigned long long number( const char* key) const {
+			const std::string& value = text( key);
+			std::size_t end = 0;
+			unsigned long long n = 0;
+			if( !value.empty() && value[0] >= '0' && value[0] <= '9') {
+				try {
+					n = std::stoull( value, &end);
+				} catch( const std::exception&) {
+					end = 0;
+				}
+			}
+			if( !end || end != value.size())
+				fail( line, std::string("option ") + key + " needs a number, got " + value);
+			return n;
+		}
+
+		unsigned long long number( const char* key, unsigned long long fallback) const {
+			return has( key) ? number( key) : fallback;
+		}
+
+		double real( const char* key) const {
+			const std::string& value = text( key);
+			std::size_t end = 0;
+			double d = 0;
+			try {
+				d = std::stod( value, &end);
+			} catch( const std::exception&) {
+				end = 0;
+			}
+			if( !end || end != value.size() || !( d > 0))
+				fail( line, std::string("option ") + key + " needs a positive number, got " + value);
+			return d;
+		}
+
+		bool flag( const char* key, bool fallback) const {
+			if( !has( key))
+				return fallback;
+			const std::string& value = text( key);
+			if( value == "true")
+				return true;
+			if( value != "false")
+				fail( line, std::string("option ") + key + " needs true or false, got " + value);
+			return false;
+		}
+
+		LogLevel level( const char* key, LogLevel fallback) const {
+			if( !has( key))
+				return fallback;
+			const std::string& value = text( key);
+			for( int ll = LL_emerg; ll <= LL_debug; ++ll) {
+				if( value == levelNames[ll])
+					return static_cast<LogLevel>(ll);
+			}
+			fail( line, std::string("option ") + key + " needs a log level, got " + value);
+		}
+
+	private:
+		const std::map<std::string, std::string>& values;
+		const unsigned line;
+	};
+
+	//! the watcher reloading on SIGHUP, its eventfd
+	std::atomic<int> sighupFd( -1);
+	struct sigaction previousSighup;
+
+	void sighupHandler( int /* sig */) {
+		int fd = sighupFd.load( std::memory_order_acquire);
+		if( fd >= 0) {
+			std::uint64_t one = 1;
+			ssize_t written = ::write( fd, &one, sizeof(one));
+			(void)written;
+		}
+	}
+
+	void wake( int fd) {
+		std::uint64_t one = 1;
+		while( ::write( fd, &one, sizeof(one)) < 0 && errno == EINTR)
+			;
+	}
+} // namespace
+
+LogConfig::LogConfig()
+: async( false)
+, capacity( 0)
+, policy( OP_block)
+, dropLL( LL_info) {}
+
+LogConfig LogConfig::parse( std::istream& in) {
+	LogConfig config;
+	std::string text;
+	for( unsigned line = 1; std::getline( in, text); ++line) {
+		std::istringstream words( text);
+		std::string keyword;
+		if( !( words >> keyword) || keyword[0] == '#')
+			continue;
+
+		std::string type;
+		if( keyword == "link" && !( words >> type))
+			fail( line, "link needs a type");
+
+		std::map<std::string, std::string> options;
+		for( std::string word; words >> word; ) {
+			std::size_t eq = word.find( '=');
+			if( eq == std::string::npos || !eq)
+				fail( line, "expected key=value, got " + word);
+			if( !options.insert( std::make_pair( word.substr( 0, eq), word.substr( eq + 1))).second)
+				fail( line, "option " + word.substr( 0, eq) + " given twice");
+		}
+		Options o( options, line);
+
+		if( keyword == "link") {
+			const LinkType* found = 0;
+			for( const LinkType& linkType : linkTypes) {
+				if( type == linkType.name)
+					found = &linkType;
+			}
+			if( !found)
+				fail( line, "unknown link type " + type);
+			checkOptions( line, type, options, found->options);
+			Link link = { type, options, line };
+			config.links.push_back( link);
+		} else if( keyword == "level") {
+			checkOptions( line, keyword, options, "name value");
+			config.levels.push_back( std::make_pair( o.text( "name", ""), o.level( "value", LL_debug)));
+			if( !o.has( "value"))
+				fail( line, "missing option value");
+		} else if( keyword == "async") {
+			checkOptions( line, keyword, options, "capacity policy drop_level");
+			config.async = true;
+			config.capacity = static_cast<std::size_t>( o.number( "capacity"));
+			std::string policy = o.text( "policy", "block");
+			if( policy == "block")
+				config.policy = OP_block;
+			else if( policy == "drop_newest")
+				config.policy = OP_dropNewest;
+			else if( policy == "drop_by_level")
+				config.policy = OP_dropByLevel;
+			else
+				fail( line, "unknown overflow policy " + policy);
+			config.dropLL = o.level( "drop_level", LL_info);
+		} else {
+			fail( line, "unknown keyword " + keyword);
+		}
+	}
+	return config;
+}
+
+LogConfig LogConfig::load( const std::string& filename) {
+	std::ifstream in( filename.c_str());
+	if( !in)
+		throw std::invalid_argument("could not read log config " + filename);
+	return parse( in);
+}
+
+outputChain* LogConfig::buildChain() const {
+	std::unique_ptr<outputChain> chain;
+	for( auto link = links.rbegin(); link != links.rend(); ++link)
+		chain.reset( createLink( *link, chain));
+	return chain.release();
+}
+
+outputChain* LogConfig::createLink( const Link& link, std::unique_ptr<outputChain>& next) {
+	// all options are read before the link takes over next
+	Options o( link.options, link.line);
+	const std::string& type = link.type;
+	LogLevel ll = o.level( "level", type == "metrics" ? LL_info : LL_debug);
+	bool propagate = o.flag( "propagate", true);
+
+	if( type == "cout")
+		return new coutChainLink( ll, propagate, next.release());
+	if( type == "cerr")
+		return new cerrChainLink( ll, propagate, next.release());
+	if( type == "file" || type == "json") {
+		const std::string& path = o.text( "path");
+		bool append = o.flag( "append", true);
+		std::size_t buffer = static_cast<std::size_t>( o.number( "buffer", 0));
+		std::chrono::milliseconds flushInterval( o.number( "flush_ms", 1000));
+		LogLevel flushLL = o.level( "flush_level", LL_error);
+		unsigned long long rotateBytes = o.number( "rotate_bytes", 0);
+		std::chrono::seconds rotateInterval( o.number( "rotate_s", 0));
+		unsigned keep = static_cast<unsigned>( o.number( "keep", 0));
+		bool compress = o.flag( "compress", false);
+
+		std::unique_ptr<fileChainLink> file( type == "json"
+			? new jsonFileChainLink( path, !append, ll, propagate, next.release())
+			: new fileChainLink( path, !append, ll, propagate, next.release()));
+		if( buffer)
+			file->setBuffering( buffer, flushInterval, flushLL);
+		if( rotateBytes || rotateInterval.count())
+			file->setRotation( rotateBytes, rotateInterval, keep, compress);
+		return file.release();
+	}
+	if( type == "ring") {
+		const std::string& path = o.text( "path");
+		std::size_t capacity = static_cast<std::size_t>( o.number( "capacity"));
+		return new ringFileChainLink( path, capacity, ll, propagate, next.release());
+	}
+	if( type == "binary")
+		return new binaryFileChainLink( o.text( "path"), ll, propagate, next.release());
+	if( type == "syslog") {
+		const std::string& identity = o.text( "identity");
+		std::string socket = o.text( "socket", "/dev/log");
+		std::string format = o.text( "format", "rfc3164");
+		if( format != "rfc3164" && format != "rfc5424")
+			fail( link.line, "unknown syslog format " + format);
+		int facility = static_cast<int>( o.number( "facility", 1));
+		return new syslogSocketChainLink( identity, ll, socket, format == "rfc5424" ? SF_rfc5424 : SF_rfc3164,
+			facility, propagate, next.release());
+	}
+	if( type == "tagging") {
+		std::string format = o.text( "format", "elapsed");
+		if( format != "elapsed" && format != "iso8601")
+			fail( link.line, "unknown time format " + format);
+		unsigned digits = static_cast<unsigned>( o.number( "digits", 3));
+		return new taggingChainLink( next.release(), format == "iso8601" ? TF_iso8601 : TF_elapsed, digits);
+	}
+	if( type == "ratelimit") {
+		double rate = o.real( "rate");
+		unsigned burst = static_cast<unsigned>( o.number( "burst"));
+		std::chrono::milliseconds summaryInterval( o.number( "summary_ms", 1000));
+		std::size_t buckets = static_cast<std::size_t>( o.number( "buckets", 1024));
+		return new rateLimitingChainLink( rate, burst, next.release(), summaryInterval, buckets);
+	}
+	if( type == "backtrace") {
+		std::size_t depth = static_cast<std::size_t>( o.number( "depth"));
+		LogLevel triggerLL = o.level( "trigger", LL_error);
+		return new backtraceChainLink( depth, triggerLL, next.release());
+	}
+	// metrics, the only type left after parse()
+	std::chrono::milliseconds interval( o.number( "interval_ms"));
+	return new metricsChainLink( interval, ll, next.release());
+}
+
+void LogConfig::apply( Log& log, bool startAsync /* = true */) const {
+	log.setOutputChain( buildChain(), levels);
+
+	if( !startAsync)
+		return;
+	if( async)
+		log.startAsync( capacity, policy, dropLL);
+	else
+		log.stopAsync();
+}
+
+void LogConfig::checkReload( const LogConfig& previous) const {
+	for( const Link& link : links) {
+		if( link.type != "ring")
+			continue;
+		Options o( link.options, link.line);
+		for( const Link& old : previous.links) {
+			Options p( old.options, old.line);
+			if( old.type == "ring" && p.text( "path") == o.text( "path") && p.number( "capacity") != o.number( "capacity"))
+				fail( link.line, "ring file " + o.text( "path") + " can not change its capacity while it is in use");
+		}
+	}
+}
+
+void LogConfig::continueFiles( const LogConfig& previous) {
+	for( Link& link : links) {
+		if( link.type != "file" && link.type != "json")
+			continue;
+		Options o( link.options, link.line);
+		for( const Link& old : previous.links) {
+			Options p( old.options, old.line);
+			if( ( old.type == "file" || old.type == "json") && p.text( "path") == o.text( "path"))
+				link.options["append"] = "true";
+		}
+	}
+}
+
+LogConfigWatcher::LogConfigWatcher( Log& log, const std::string& filename, bool onSighup /* = false */)
+: log( log)
+, filename( filename)
+, current( LogConfig::load( filename))
+, onSighup( onSighup)
+, inotifyFd( -1)
+, wakeFd( -1)
+, stopping( false)
+, m_reloads( 0) {
+	current.apply( log);
+	m_reloads = 1;
+
+	std::size_t slash = filename.rfind( '/');
+	std::string directory = slash == std::string::npos ? "." : filename.substr( 0, slash + 1);
+	inotifyFd = ::inotify_init1( IN_CLOEXEC | IN_NONBLOCK);
+	wakeFd = ::eventfd( 0, EFD_CLOEXEC | EFD_NONBLOCK);
+	if( inotifyFd < 0 || wakeFd < 0
+			|| ::inotify_add_watch( inotifyFd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE) < 0) {
+		if( inotifyFd >= 0)
+			::close( inotifyFd);
+		if( wakeFd >= 0)
+			::close( wakeFd);
+		throw std::invalid_argument("could not watch log config " + filename);
+	}
+
+	if( onSighup) {
+		int none = -1;
+		if( !sighupFd.compare_exchange_strong( none, wakeFd)) {
+			::close( inotifyFd);
+			::close( wakeFd);
+			throw std::invalid_argument("another log config watcher reloads on SIGHUP");
+		}
+		struct sigaction action;
+		std::memset( &action, 0, sizeof(action));
+		action.sa_handler = sighupHandler;
+		action.sa_flags = SA_RESTART;
+		sigemptyset( &action.sa_mask);
+		::sigaction( SIGHUP, &action, &previousSighup);
+	}
+
+	worker = std::thread( &LogConfigWatcher::watch, this);
+}
+
+LogConfigWatcher::~LogConfigWatcher() {
+	stopping = true;
+	wake( wakeFd);
+	worker.join();
+	if( onSighup) {
+		::sigaction( SIGHUP, &previousSighup, 0);
+		sighupFd.store( -1, std::memory_order_release);
+	}
+	::close( inotifyFd);
+	::close( wakeFd);
+}
+
+void LogConfigWatcher::reload() {
+	wake( wakeFd);
+}
+
+void LogConfigWatcher::watch() {
+	std::size_t slash = filename.rfind( '/');
+	std::string name = slash == std::string::npos ? filename : filename.substr( slash + 1);
+	pollfd fds[2] = { { inotifyFd, POLLIN, 0 }, { wakeFd, POLLIN, 0 } };
+	alignas(inotify_event) char events[4096];
+
+	while( !stopping) {
+		if( ::poll( fds, 2, -1) < 0) {
+			if( errno == EINTR)
+				continue;
+			break;
+		}
+
+		bool changed = false;
+		if( fds[0].revents & POLLIN) {
+			ssize_t len;
+			while( ( len = ::read( inotifyFd, events, sizeof(events))) > 0) {
+				for( char* p = events; p < events + len; ) {
+					const inotify_event* event = reinterpret_cast<const inotify_event*>(p);
+					if( event->len && name == event->name)
+						changed = true;
+					p += sizeof(inotify_event) + event->len;
+				}
+			}
+		}
+		if( fds[1].revents & POLLIN) {
+			std::uint64_t count;
+			while( ::read( wakeFd, &count, sizeof(count)) < 0 && errno == EINTR)
+				;
+			changed = true;
+		}
+		if( changed && !stopping)
+			apply();
+	}
+}
+
+void LogConfigWatcher::apply() {
+	try {
+		LogConfig next = LogConfig::load( filename);
+		next.checkReload( current);
+		next.continueFiles( current);
+		next.apply( log, false);
+		current = next;
+		m_reloads.fetch_add( 1, std::memory_order_release);
+	} catch( const std::exception& e) {
+		log.message( LL_error) << "log config " << filename << " not applied: " << e.what();
+	}
+}
@@ -0,0 +1,179 @@
+#ifndef LogConfig_h_
+#define LogConfig_h_
+
+#include "Log.h"
+
+#include <atomic>
+#include <istream>
+#include <map>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+/*!
+ * \file LogConfig.h
+ * \ingroup Logging
+ *
+ * Provides the configuration of a Log by a text file, and reloading it
+ * while the process runs.
+ */
+
+//! the output chain, log levels and asynchronous mode of a Log, read from text
+/*!
+ * Every line holds a keyword followed by options of the form key=value,
+ * empty lines and lines starting with # are ignored. The link lines make up
+ * the output chain, in the order they appear.
+ * \code
+ * # asynchronous mode, see Log::startAsync()
+ * async capacity=4096 policy=drop_by_level drop_level=info
+ * # log levels of the root (no name) and of child loggers, see Log::setLevel()
+ * level value=info
+ * level name=net.http value=debug
+ * link tagging format=iso8601 digits=6
+ * link file path=/var/log/app.log level=info buffer=65536 rotate_bytes=100000000 keep=5
+ * link syslog identity=app level=error format=rfc5424
+ * \endcode
+ *
+ * Links and their options, besides level and propagate (true or false) of
+ * the links writing messages:
+ * - cout, cerr
+ * - file, json: path, append (true), buffer (bytes), flush_ms (1000),
+ *   flush_level (error), rotate_bytes, rotate_s, keep, compress (false)
+ * - ring: path, capacity
+ * - binary: path
+ * - syslog: identity, socket (/dev/log), format (rfc3164 or rfc5424), facility (1)
+ * - tagging: format (elapsed or iso8601), digits (3)
+ * - ratelimit: rate, burst, summary_ms (1000), buckets (1024)
+ * - backtrace: depth, trigger (error)
+ * - metrics: interval_ms, level (info, the level of the reports)
+ *
+ * Errors are reported as std::invalid_argument naming the line.
+ */
+class LogConfig {
+public:
+	//! an empty configuration, without links
+	LogConfig();
+
+	//! parses a configuration
+	/*!
+	 * \throw std::invalid_argument if a line is not understood
+	 */
+	static LogConfig parse( std::istream& in);
+
+	//! reads and parses a configuration file
+	static LogConfig load( const std::string& filename);
+
+	//! creates the output chain, owned by the caller, 0 if there are no links
+	/*!
+	 * \throw std::invalid_argument if a link can not be created, e.g. a
+	 * 	file can not be opened
+	 */
+	outputChain* buildChain() const;
+
+	//! installs the configuration in log
+	/*!
+	 * Builds the output chain before replacing the one of log together with
+	 * the log levels. Other threads may log meanwhile, no message is lost.
+	 * Switching the asynchronous mode needs a quiet Log, so it is only done
+	 * with startAsync set, which is meant for the start of the process.
+	 */
+	void apply( Log& log, bool startAsync = true) const;
+
+	//! checks that this configuration can replace previous while it is in use
+	/*!
+	 * The new links are created while the old ones still write, files are
+	 * continued. A ring file keeps its size while it is mapped, so a ring
+	 * link of the same path has to keep its capacity.
+	 * \throw std::invalid_argument naming the line of the offending link
+	 */
+	void checkReload( const LogConfig& previous) const;
+
+	//! appends to the files previous writes to instead of truncating them
+	/*!
+	 * A file or json link with append=false would erase what was logged
+	 * to a file that is still in use, so on reload it continues the file
+	 * if a file or json link of previous has the same path.
+	 */
+	void continueFiles( const LogConfig& previous);
+
+	//! true if the configuration asks for asynchronous mode
+	bool asynchronous() const { return async; }
+
+private:
+	//! a link line
+	struct Link {
+		std::string type;
+		std::map<std::string, std::string> options;
+		unsigned line;
+	};
+
+	//! creates the link described by link in front of next
+	static outputChain* createLink( const Link& link, std::unique_ptr<outputChain>& next);
+
+	std::vector<Link> links;
+	//! the levels of the level lines, by logger name
+	std::vector<std::pair<std::string, LogLevel>> levels;
+	bool async;
+	std::size_t capacity;
+	OverflowPolicy policy;
+	LogLevel dropLL;
+};
+
+//! reloads the configuration of a Log when its file changes
+/*!
+ * A background thread watches the file with inotify, optionally also
+ * reloading it on SIGHUP, and installs the new configuration with
+ * LogConfig::apply(). Logging threads are not stopped while the new output
+ * chain is built and swapped in. If the file can not be read or parsed, the
+ * current configuration stays and the error is logged, as it does if
+ * LogConfig::checkReload() rejects the new one.
+ *
+ * The file is loaded and applied, including the asynchronous mode, by the
+ * constructor, errors of that first load are thrown.
+ * \code
+ * LogConfigWatcher watcher( logger, "/etc/app/log.conf", true);
+ * \endcode
+ */
+class LogConfigWatcher {
+public:
+	/*!
+	 * \param log the Log to configure
+	 * \param filename the configuration file
+	 * \param onSighup reload on SIGHUP too, only one watcher of a
+	 * 	process can do so
+	 * \throw std::invalid_argument if the file can not be loaded
+	 */
+	LogConfigWatcher( Log& log, const std::string& filename, bool onSighup = false);
+	~LogConfigWatcher();
+
+	//! let the background thread reload the configuration
+	void reload();
+
+	//! number of times the configuration was installed, including the first load
+	std::size_t reloads() const { return m_reloads.load( std::memory_order_acquire); }
+
+private:
+	LogConfigWatcher( const LogConfigWatcher&);
+	LogConfigWatcher& operator=( const LogConfigWatcher&);
+
+	//! body of the background thread
+	void watch();
+	//! loads and applies the file, logging errors
+	void apply();
+
+	Log& log;
+	const std::string filename;
+	//! the configuration installed last
+	LogConfig current;
+	const bool onSighup;
+	//! inotify descriptor watching the directory of the file
+	int inotifyFd;
+	//! eventfd waking the background thread, for reload() and stopping
+	int wakeFd;
+	std::atomic<bool> stopping;
+	std::atomic<std::size_t> m_reloads;
+	std::thread worker;
+};
+
+#endif // LogConfig_h_
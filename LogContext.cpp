@@ -0,0 +1,55 @@
+#include "LogContext.h"
+
+namespace {
+	//! the context of the calling thread
+	thread_local LogContext::Ptr threadContext;
+} // namespace
+
+LogContext::LogContext( const LogContext* parent, const char* prefix, std::size_t len, const char* fields, std::size_t fieldsLen) {
+	if( parent) {
+		m_prefix = parent->m_prefix;
+		m_fields = parent->m_fields;
+	}
+	m_prefix.append( prefix, len);
+	m_fields.append( fields, fieldsLen);
+}
+
+const LogContext* LogContext::current() {
+	return threadContext.get();
+}
+
+LogContext::Ptr LogContext::capture() {
+	return threadContext;
+}
+
+LogScope::LogScope( const std::string& prefix)
+: previous( threadContext) {
+	threadContext.reset( new LogContext( previous.get(), prefix.data(), prefix.size(), 0, 0));
+}
+
+LogScope::LogScope( const LogContext::Ptr& context)
+: previous( threadContext) {
+	threadContext = context;
+}
+
+LogScope::~LogScope() {
+	threadContext = std::move( previous);
+}
+
+void LogScope::enter( MessageBuffer& fields) {
+	const std::string& encoded = fields.str();
+	const char* args = encoded.data();
+	const char* end = args + encoded.size();
+	LogArguments::Argument key, value;
+	MessageBuffer prefix;
+	if( LogArguments::decode( args, end, key) && LogArguments::decode( args, end, value)) {
+		LogArguments::append( key, prefix);
+		prefix.append( "=", 1);
+		LogArguments::append( value, prefix);
+		prefix.append( " ", 1);
+	}
+
+	previous = threadContext;
+	const std::string& text = prefix.str();
+	threadContext.reset( new LogContext( previous.get(), text.data(), text.size(), encoded.data(), encoded.size()));
+}
@@ -0,0 +1,104 @@
+#ifndef LogContext_h_
+#define LogContext_h_
+
+#include "LogRecord.h"
+#include "MessageBuffer.h"
+
+#include <memory>
+#include <string>
+
+/*!
+ * \file LogContext.h
+ * \ingroup Logging
+ *
+ * This file should not be included directly, as it is provided by Log.h
+ * Provides the context a thread adds to all messages it logs.
+ */
+
+//! the context added to the messages of a thread
+/*!
+ * A context is entered with a LogScope and holds the prefix and the
+ * key/value fields of all scopes the thread is in, formatted when the scope
+ * was entered. Every message the thread logs starts with the prefix and
+ * carries the fields, in front of the fields of the message.
+ *
+ * Contexts are immutable, capture() shares the current one with work handed
+ * to another thread, which installs it with a LogScope.
+ * \code
+ * LogScope request( "request", id);
+ * logger.message(LL_info) << "started";		// "request=42 started"
+ *
+ * auto context = LogContext::capture();
+ * pool.submit( [context] {
+ * 	LogScope scope( context);
+ * 	logger.message(LL_info) << "working";	// "request=42 working"
+ * });
+ * \endcode
+ */
+class LogContext {
+	friend class LogScope;
+public:
+	//! a context shared between threads
+	typedef std::shared_ptr<const LogContext> Ptr;
+
+	//! the context of the calling thread, 0 outside of any LogScope
+	static const LogContext* current();
+
+	//! the context of the calling thread, to be installed on another thread
+	static Ptr capture();
+
+	//! the text put in front of each message
+	const std::string& prefix() const { return m_prefix; }
+
+	//! the encoded key/value fields, see LogRecord::fields()
+	const std::string& fields() const { return m_fields; }
+
+private:
+	LogContext( const LogContext* parent, const char* prefix, std::size_t len, const char* fields, std::size_t fieldsLen);
+	LogContext( const LogContext&);
+	LogContext& operator=( const LogContext&);
+
+	std::string m_prefix;
+	std::string m_fields;
+};
+
+//! enters a context of the calling thread while it exists
+/*!
+ * The previous context of the thread is restored on destruction, so scopes
+ * have to be destroyed in the reverse order they were created, as they are
+ * when used as local variables.
+ */
+class LogScope {
+public:
+	//! adds prefix in front of the messages, usually ending with a space
+	explicit LogScope( const std::string& prefix);
+
+	//! adds a key/value field, and "key=value " in front of the messages
+	/*!
+	 * The value is encoded like the arguments of LogWriter::kv().
+	 */
+	template<class T>
+	LogScope( const char* key, const T& value) {
+		MessageBuffer fields;
+		LogArguments::encode( fields, key);
+		LogArguments::encode( fields, value);
+		enter( fields);
+	}
+
+	//! installs a context taken with LogContext::capture(), 0 to log without context
+	explicit LogScope( const LogContext::Ptr& context);
+
+	~LogScope();
+
+private:
+	LogScope( const LogScope&);
+	LogScope& operator=( const LogScope&);
+
+	//! enters a context with the encoded key/value pair in fields
+	void enter( MessageBuffer& fields);
+
+	//! the context of the thread before this scope
+	LogContext::Ptr previous;
+};
+
+#endif // LogContext_h_
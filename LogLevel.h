@@ -20,4 +20,14 @@ enum LogLevel {
 	LL_debug		///< Only used for messages required for debugging the program, those should be removed if the error is found
 };
 
+//! the most verbose log level which is compiled in
+/*!
+ * Messages logged through Log::message<LogLevel>() or LOG_MESSAGE with
+ * a more verbose log level are removed at compile time.
+ * Set by the LOG_COMPILED_LEVEL CMake option.
+ */
+#ifndef LOG_COMPILED_LEVEL
+#define LOG_COMPILED_LEVEL LL_debug
+#endif
+
 #endif // LogLevel_h_
\ No newline at end of file
@@ -0,0 +1,48 @@
+#include "LogMetrics.h"
+
+namespace {
+	//! the slot of ThreadLevelCounters taken by the next thread
+	std::atomic<std::size_t> nextSlot( 0);
+} // namespace
+
+LinkMetrics::LinkMetrics()
+: written()
+, filtered()
+, bytes( 0)
+, writeTime( 0)
+, lockWait( 0) {}
+
+LogMetrics::LogMetrics()
+: logged()
+, dropped()
+, queueHighWater( 0) {}
+
+LevelCounters::LevelCounters() {
+	for( auto& counter : counters)
+		counter.store( 0, std::memory_order_relaxed);
+}
+
+void LevelCounters::read( unsigned long long* values) const {
+	for( std::size_t i = 0; i < logLevels; ++i)
+		values[i] = counters[i].load( std::memory_order_relaxed);
+}
+
+ThreadLevelCounters::ThreadLevelCounters() {
+	for( auto& slot : slots) {
+		for( auto& counter : slot.counters)
+			counter.store( 0, std::memory_order_relaxed);
+	}
+}
+
+std::size_t ThreadLevelCounters::threadSlot() {
+	thread_local std::size_t slot = nextSlot.fetch_add( 1, std::memory_order_relaxed) % slotCount;
+	return slot;
+}
+
+void ThreadLevelCounters::read( unsigned long long* values) const {
+	for( std::size_t i = 0; i < logLevels; ++i) {
+		values[i] = 0;
+		for( auto& slot : slots)
+			values[i] += slot.counters[i].load( std::memory_order_relaxed);
+	}
+}
@@ -0,0 +1,107 @@
+#ifndef LogMetrics_h_
+#define LogMetrics_h_
+
+#include "LogLevel.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <vector>
+
+/*!
+ * \file LogMetrics.h
+ * \ingroup Logging
+ *
+ * This file should not be included directly, as it is provided by Log.h
+ * Provides the counters Log and the output links keep about the messages
+ * they handled.
+ */
+
+//! number of log levels, the size of the per level counters
+const std::size_t logLevels = LL_debug + 1;
+
+//! counters of an output link, see outputChain::metrics()
+struct LinkMetrics {
+	LinkMetrics();
+
+	//! messages written by the link
+	unsigned long long written[logLevels];
+	//! messages which reached the link but were below its minimum log level
+	unsigned long long filtered[logLevels];
+	//! bytes of the messages written, in the encoding of the link
+	unsigned long long bytes;
+	//! time spent writing messages, only measured after outputChain::setTimed()
+	std::chrono::nanoseconds writeTime;
+	//! time spent waiting for the mutex of the link, only measured after outputChain::setTimed()
+	std::chrono::nanoseconds lockWait;
+};
+
+//! counters of a Log, see Log::metrics()
+struct LogMetrics {
+	LogMetrics();
+
+	//! messages passed to the output chain or queued
+	unsigned long long logged[logLevels];
+	//! messages dropped because the asynchronous queue was full
+	unsigned long long dropped[logLevels];
+	//! the most messages which were waiting in the asynchronous queue
+	std::size_t queueHighWater;
+	//! the counters of the links of the current output chain, in their order
+	std::vector<LinkMetrics> links;
+};
+
+//! a counter per log level, to be updated from several threads
+/*!
+ * Counters are only incremented with relaxed atomic operations, reading
+ * them gives a recent, but not necessarily consistent, state.
+ */
+class LevelCounters {
+public:
+	LevelCounters();
+
+	void add( LogLevel ll) { counters[ll].fetch_add( 1, std::memory_order_relaxed); }
+
+	//! copy the counters to the array values of logLevels elements
+	void read( unsigned long long* values) const;
+
+private:
+	LevelCounters( const LevelCounters&);
+	LevelCounters& operator=( const LevelCounters&);
+
+	std::atomic<unsigned long long> counters[logLevels];
+};
+
+//! a counter per log level, incremented by many threads without sharing a cache line
+/*!
+ * Every thread adds to one of a fixed number of slots, assigned round robin
+ * the first time it counts, so up to slotCount threads never write to the
+ * same cache line. read() sums the slots.
+ */
+class ThreadLevelCounters {
+public:
+	ThreadLevelCounters();
+
+	void add( LogLevel ll) { slots[threadSlot()].counters[ll].fetch_add( 1, std::memory_order_relaxed); }
+
+	//! copy the sums of the counters to the array values of logLevels elements
+	void read( unsigned long long* values) const;
+
+private:
+	ThreadLevelCounters( const ThreadLevelCounters&);
+	ThreadLevelCounters& operator=( const ThreadLevelCounters&);
+
+	//! the slot of the calling thread
+	static std::size_t threadSlot();
+
+	static const std::size_t slotCount = 16;
+
+	struct Slot {
+		std::atomic<unsigned long long> counters[logLevels];
+		//! keeps the counters of different slots on different cache lines
+		char padding[64];
+	};
+
+	Slot slots[slotCount];
+};
+
+#endif // LogMetrics_h_
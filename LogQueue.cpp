@@ -0,0 +1,265 @@
+#include "LogQueue.h"
+
+#include <stdexcept>
+#include <utility>
+
+//! single producer, single consumer ring of one thread
+/*!
+ * head is only written by the consumer, tail only by the producer.
+ * The padding keeps the fields of both sides on different cache lines.
+ */
+class LogQueue::Ring {
+public:
+	Ring( std::size_t capacity)
+	: slots( capacity)
+	, next( 0)
+	, refs( 2)
+	, head( 0)
+	, handled( 0)
+	, tail( 0)
+	, cachedHead( 0)
+	, dropped( 0)
+	, abandoned( false)
+	, detached( false) {}
+
+	//! drop one of the references held by the queue and the thread
+	void release() {
+		if( refs.fetch_sub( 1, std::memory_order_acq_rel) == 1)
+			delete this;
+	}
+
+	std::vector<Entry> slots;
+	//! the next older ring of the queue
+	Ring* next;
+	std::atomic<int> refs;
+
+	char padding0[64];
+	//! number of messages taken by the consumer
+	std::atomic<unsigned long long> head;
+	//! number of messages handled by the consumer
+	std::atomic<unsigned long long> handled;
+
+	char padding1[64];
+	//! number of messages pushed by the producer
+	std::atomic<unsigned long long> tail;
+	//! head as last seen by the producer
+	unsigned long long cachedHead;
+	std::atomic<std::size_t> dropped;
+
+	char padding2[64];
+	//! set when the thread exited, the ring can be taken by another thread
+	std::atomic<bool> abandoned;
+	//! set when the queue was destroyed
+	std::atomic<bool> detached;
+};
+
+namespace {
+	//! the id of the next queue created
+	std::atomic<unsigned long long> nextQueueId( 1);
+
+	//! the rings of the calling thread, by queue id
+	/*!
+	 * Abandons the rings when the thread exits, so other threads can take
+	 * them over.
+	 */
+	class RingCache {
+	public:
+		~RingCache() {
+			for( auto& ring : rings) {
+				ring.second->abandoned.store( true, std::memory_order_release);
+				ring.second->release();
+			}
+		}
+
+		LogQueue::Ring* find( unsigned long long id) const {
+			for( auto& ring : rings)
+				if( ring.first == id)
+					return ring.second;
+			return 0;
+		}
+
+		void add( unsigned long long id, LogQueue::Ring* ring) {
+			// forget the rings of destroyed queues first
+			for( std::size_t i = 0; i < rings.size(); ) {
+				if( rings[i].second->detached.load( std::memory_order_acquire)) {
+					rings[i].second->release();
+					rings[i] = rings.back();
+					rings.pop_back();
+				} else {
+					++i;
+				}
+			}
+			rings.push_back( std::make_pair( id, ring));
+		}
+
+	private:
+		std::vector<std::pair<unsigned long long, LogQueue::Ring*>> rings;
+	};
+
+	thread_local RingCache ringCache;
+} // namespace
+
+LogQueue::LogQueue( std::size_t capacity, OverflowPolicy policy, LogLevel dropLL)
+: rings( 0)
+, id( nextQueueId.fetch_add( 1, std::memory_order_relaxed))
+, capacity( capacity)
+, policy( policy)
+, dropLL( dropLL)
+, closed( false)
+, current( 0)
+, m_highWater( 0)
+, blockedProducers( 0)
+, flushers( 0)
+, consumerSleeping( false) {
+	if( !capacity)
+		throw std::invalid_argument("log queue needs at least one slot");
+}
+
+LogQueue::~LogQueue() {
+	for( Ring* ring = rings.load( std::memory_order_acquire); ring; ) {
+		Ring* next = ring->next;
+		ring->detached.store( true, std::memory_order_release);
+		ring->release();
+		ring = next;
+	}
+}
+
+LogQueue::Ring& LogQueue::threadRing() {
+	if( Ring* ring = ringCache.find( id))
+		return *ring;
+
+	for( Ring* ring = rings.load( std::memory_order_acquire); ring; ring = ring->next) {
+		bool abandoned = true;
+		if( ring->abandoned.load( std::memory_order_relaxed)
+				&& ring->abandoned.compare_exchange_strong( abandoned, false, std::memory_order_acquire)) {
+			ring->refs.fetch_add( 1, std::memory_order_relaxed);
+			ringCache.add( id, ring);
+			return *ring;
+		}
+	}
+
+	Ring* ring = new Ring( capacity);
+	ring->next = rings.load( std::memory_order_relaxed);
+	while( !rings.compare_exchange_weak( ring->next, ring, std::memory_order_release, std::memory_order_relaxed))
+		;
+	ringCache.add( id, ring);
+	return *ring;
+}
+
+bool LogQueue::push( const LogRecord& rec) {
+	LogLevel ll = rec.level();
+	Ring& ring = threadRing();
+	unsigned long long tail = ring.tail.load( std::memory_order_relaxed);
+	if( tail - ring.cachedHead == capacity) {
+		ring.cachedHead = ring.head.load( std::memory_order_acquire);
+		if( tail - ring.cachedHead == capacity) {
+			if( policy == OP_dropNewest || ( policy == OP_dropByLevel && ll >= dropLL)) {
+				ring.dropped.store( ring.dropped.load( std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+				return false;
+			}
+
+			std::unique_lock<std::mutex> lk(m_m);
+			blockedProducers.fetch_add( 1);
+			notFull.wait( lk, [this, &ring, tail] { return tail - ring.head.load() < capacity; });
+			blockedProducers.fetch_sub( 1);
+			ring.cachedHead = ring.head.load( std::memory_order_acquire);
+		}
+	}
+
+	auto& slot = ring.slots[ tail % capacity];
+	slot.ll = ll;
+	slot.time = rec.time();
+	slot.site = rec.deferred() ? rec.site() : 0;
+	slot.data.assign( rec.deferred() ? rec.arguments() : rec.text());
+	slot.fields.assign( rec.fields());
+	ring.tail.store( tail + 1);
+
+	if( consumerSleeping.load()) {
+		std::lock_guard<std::mutex> lk(m_m);
+		notEmpty.notify_one();
+	}
+	return true;
+}
+
+LogQueue::Ring* LogQueue::oldest() {
+	Ring* oldest = 0;
+	long long oldestTime = 0;
+	std::size_t waiting = 0;
+	for( Ring* ring = rings.load( std::memory_order_acquire); ring; ring = ring->next) {
+		unsigned long long head = ring->head.load( std::memory_order_relaxed);
+		unsigned long long tail = ring->tail.load();
+		if( tail == head)
+			continue;
+		waiting += static_cast<std::size_t>( tail - head);
+		long long time = ring->slots[ head % capacity].time;
+		if( !oldest || time < oldestTime) {
+			oldest = ring;
+			oldestTime = time;
+		}
+	}
+	if( waiting > m_highWater.load( std::memory_order_relaxed))
+		m_highWater.store( waiting, std::memory_order_relaxed);
+	return oldest;
+}
+
+bool LogQueue::pop( Entry& entry) {
+	Ring* ring = oldest();
+	if( !ring) {
+		std::unique_lock<std::mutex> lk(m_m);
+		consumerSleeping.store( true);
+		notEmpty.wait( lk, [this, &ring] { return ( ring = oldest()) || closed.load(); });
+		consumerSleeping.store( false, std::memory_order_relaxed);
+		if( !ring)
+			return false;
+	}
+
+	unsigned long long head = ring->head.load( std::memory_order_relaxed);
+	auto& slot = ring->slots[ head % capacity];
+	entry.ll = slot.ll;
+	entry.time = slot.time;
+	entry.site = slot.site;
+	entry.data.swap( slot.data);
+	entry.fields.swap( slot.fields);
+	ring->head.store( head + 1);
+	current = ring;
+
+	if( blockedProducers.load()) {
+		std::lock_guard<std::mutex> lk(m_m);
+		notFull.notify_all();
+	}
+	return true;
+}
+
+void LogQueue::done() {
+	current->handled.store( current->handled.load( std::memory_order_relaxed) + 1);
+	if( flushers.load()) {
+		std::lock_guard<std::mutex> lk(m_m);
+		allHandled.notify_all();
+	}
+}
+
+void LogQueue::flush() {
+	std::unique_lock<std::mutex> lk(m_m);
+	flushers.fetch_add( 1);
+	// rings registered later only hold messages pushed after this call
+	for( Ring* ring = rings.load( std::memory_order_acquire); ring; ring = ring->next) {
+		unsigned long long pushed = ring->tail.load();
+		allHandled.wait( lk, [ring, pushed] { return ring->handled.load() >= pushed; });
+	}
+	flushers.fetch_sub( 1);
+}
+
+void LogQueue::close() {
+	{
+		std::lock_guard<std::mutex> lk(m_m);
+		closed = true;
+	}
+	notEmpty.notify_all();
+}
+
+std::size_t LogQueue::dropped() const {
+	std::size_t dropped = 0;
+	for( Ring* ring = rings.load( std::memory_order_acquire); ring; ring = ring->next)
+		dropped += ring->dropped.load( std::memory_order_relaxed);
+	return dropped;
+}
@@ -0,0 +1,151 @@
+#ifndef LogQueue_h_
+#define LogQueue_h_
+
+#include "LogLevel.h"
+#include "LogRecord.h"
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <cstddef>
+
+/*!
+ * \file LogQueue.h
+ * \ingroup Logging
+ *
+ * This file should not be included directly, as it is provided by Log.h
+ * Provides the queue used by Log in asynchronous mode
+ */
+
+//! what to do with a message if the queue of an asynchronous Log is full
+enum OverflowPolicy {
+	OP_block,		///< wait until the background thread made room for the message
+	OP_dropNewest,	///< discard the message which does not fit into the queue
+	OP_dropByLevel	///< discard messages at or below the drop level, wait for all others
+};
+
+//! multi producer, single consumer queue of log messages
+/*!
+ * Every producing thread gets its own bounded single producer, single
+ * consumer ring, registered the first time the thread pushes a message.
+ * Producers only write to their own ring, so threads logging at the same
+ * time do not contend for a lock or a shared cache line. The consumer takes
+ * the messages of all rings in the order of the time they were logged.
+ *
+ * The slots of a ring are allocated once. Message strings are assigned into
+ * and swapped out of the slots, so that after a warm up phase no memory is
+ * allocated while queueing a message.
+ *
+ * Rings of exited threads are reused by new threads. Any thread may push(),
+ * only one thread may pop().
+ */
+class LogQueue {
+public:
+	/*!
+	 * \param capacity the number of messages the ring of each thread can hold
+	 * \param policy what push() should do if the ring of the thread is full
+	 * \param dropLL with OP_dropByLevel, messages with this or a less severe
+	 * 	log level are dropped if the ring is full
+	 */
+	LogQueue( std::size_t capacity, OverflowPolicy policy, LogLevel dropLL);
+	~LogQueue();
+
+	//! a queued message
+	/*!
+	 * Deferred messages are queued with their encoded arguments, so they
+	 * are formatted by the consumer.
+	 */
+	struct Entry {
+		Entry() : ll( LL_emerg), time( 0), site( 0) {}
+
+		LogLevel ll;
+		//! when the message was logged, used to merge the rings
+		long long time;
+		//! call site of a deferred message, 0 for other messages
+		const LogSite* site;
+		//! the encoded arguments of a deferred message, the text otherwise
+		std::string data;
+		//! the encoded key/value fields
+		std::string fields;
+	};
+
+	//! add a message to the ring of the calling thread
+	/*!
+	 * \return false if the message was dropped
+	 */
+	bool push( const LogRecord& rec);
+
+	//! take the oldest message from all rings
+	/*!
+	 * Blocks until a message is available. The contents of entry are swapped
+	 * into the freed slot to be reused by later messages.
+	 * After popping and handling a message the consumer has to call done().
+	 *
+	 * \return false if the queue was closed and all messages were taken
+	 */
+	bool pop( Entry& entry);
+
+	//! signal that the last popped message was handled
+	void done();
+
+	//! wait until all messages pushed before this call were handled
+	void flush();
+
+	//! wake the consumer, pop() will return false once the queue is empty
+	void close();
+
+	//! number of messages which were dropped because a ring was full
+	std::size_t dropped() const;
+
+	//! the most messages which were waiting in all rings together
+	/*!
+	 * Measured by the consumer, which sees the highest number of waiting
+	 * messages when it takes the next one.
+	 */
+	std::size_t highWater() const { return m_highWater.load( std::memory_order_relaxed); }
+
+	class Ring;
+private:
+	LogQueue( const LogQueue&);
+	LogQueue& operator=( const LogQueue&);
+
+	//! the ring of the calling thread, registering one if needed
+	Ring& threadRing();
+	//! the ring holding the oldest message, 0 if all are empty
+	/*!
+	 * Updates the high water mark, only to be called by the consumer.
+	 */
+	Ring* oldest();
+
+	//! the rings of all threads which ever pushed, newest first
+	std::atomic<Ring*> rings;
+	//! identifies the queue in the ring caches of the threads
+	const unsigned long long id;
+	const std::size_t capacity;
+	const OverflowPolicy policy;
+	const LogLevel dropLL;
+	std::atomic<bool> closed;
+
+	//! the ring the last popped message came from
+	Ring* current;
+	//! see highWater(), only written by the consumer
+	std::atomic<std::size_t> m_highWater;
+
+	//! producers waiting for room in their ring
+	std::atomic<int> blockedProducers;
+	//! threads waiting in flush()
+	std::atomic<int> flushers;
+	//! true while the consumer waits for messages
+	std::atomic<bool> consumerSleeping;
+
+	//! guards waiting on the condition variables only
+	mutable std::mutex m_m;
+	std::condition_variable notEmpty;
+	std::condition_variable notFull;
+	std::condition_variable allHandled;
+};
+
+#endif // LogQueue_h_
@@ -0,0 +1,278 @@
+#include "LogRecord.h"
+
+#include <cstdint>
+
+namespace {
+	//! the id of the next call site to register
+	std::atomic<unsigned> nextSiteId( 1);
+
+	void encodeRaw( MessageBuffer& out, LogArguments::ArgumentType type, const void* value, std::size_t len) {
+		char* first = out.reserve( len + 1);
+		*first++ = static_cast<char>(type);
+		std::memcpy( first, value, len);
+		out.commit( first + len);
+	}
+
+	//! reads len bytes at args into value, false if not enough are left
+	bool decodeRaw( const char*& args, const char* end, void* value, std::size_t len) {
+		if( static_cast<std::size_t>(end - args) < len)
+			return false;
+		std::memcpy( value, args, len);
+		args += len;
+		return true;
+	}
+
+	template<class T>
+	void appendNumber( MessageBuffer& out, T n) {
+		char* first = out.reserve( LIB::max_chars);
+		out.commit( LIB::to_chars( first, n));
+	}
+
+} // namespace
+
+const std::string LogRecord::noFields;
+
+unsigned LogSite::id() const {
+	unsigned id = m_id.load( std::memory_order_relaxed);
+	if( id)
+		return id;
+	unsigned newId = nextSiteId.fetch_add( 1, std::memory_order_relaxed);
+	if( m_id.compare_exchange_strong( id, newId, std::memory_order_relaxed))
+		return newId;
+	// another thread registered the call site first
+	return id;
+}
+
+void LogArguments::encodeSigned( MessageBuffer& out, long long n) {
+	encodeRaw( out, AT_signed, &n, sizeof(n));
+}
+
+void LogArguments::encodeUnsigned( MessageBuffer& out, unsigned long long n) {
+	encodeRaw( out, AT_unsigned, &n, sizeof(n));
+}
+
+void LogArguments::encode( MessageBuffer& out, const char* str, std::size_t len) {
+	std::uint32_t length = static_cast<std::uint32_t>(len);
+	encodeRaw( out, AT_string, &length, sizeof(length));
+	out.append( str, length);
+}
+
+void LogArguments::encodePrefix( MessageBuffer& out, const std::string& prefix) {
+	std::uint32_t length = static_cast<std::uint32_t>(prefix.size());
+	encodeRaw( out, AT_prefix, &length, sizeof(length));
+	out.append( prefix.data(), length);
+}
+
+void LogArguments::encode( MessageBuffer& out, double n) {
+	encodeRaw( out, AT_double, &n, sizeof(n));
+}
+
+void LogArguments::encode( MessageBuffer& out, char c) {
+	encodeRaw( out, AT_char, &c, 1);
+}
+
+void LogArguments::encode( MessageBuffer& out, bool b) {
+	char c = b;
+	encodeRaw( out, AT_bool, &c, 1);
+}
+
+void LogArguments::encode( MessageBuffer& out, const void* p) {
+	std::uint64_t address = reinterpret_cast<std::uintptr_t>(p);
+	encodeRaw( out, AT_pointer, &address, sizeof(address));
+}
+
+bool LogArguments::decode( const char*& args, const char* end, Argument& arg) {
+	if( args == end)
+		return false;
+
+	std::uint64_t address;
+	std::uint32_t len;
+	char c;
+	const char* p = args + 1;
+	arg.type = static_cast<ArgumentType>(*args);
+	arg.str = 0;
+	arg.len = 0;
+	switch( arg.type) {
+	case AT_signed:
+		if( !decodeRaw( p, end, &arg.s, sizeof(arg.s)))
+			return false;
+		break;
+	case AT_unsigned:
+		if( !decodeRaw( p, end, &arg.u, sizeof(arg.u)))
+			return false;
+		break;
+	case AT_double:
+		if( !decodeRaw( p, end, &arg.d, sizeof(arg.d)))
+			return false;
+		break;
+	case AT_pointer:
+		if( !decodeRaw( p, end, &address, sizeof(address)))
+			return false;
+		arg.u = address;
+		break;
+	case AT_string:
+	case AT_prefix:
+		if( !decodeRaw( p, end, &len, sizeof(len)) || static_cast<std::size_t>(end - p) < len)
+			return false;
+		arg.str = p;
+		arg.len = len;
+		p += len;
+		break;
+	case AT_char:
+		if( p == end)
+			return false;
+		arg.str = p++;
+		arg.len = 1;
+		break;
+	case AT_bool:
+		if( !decodeRaw( p, end, &c, 1))
+			return false;
+		arg.u = c ? 1 : 0;
+		break;
+	default:
+		return false;
+	}
+	args = p;
+	return true;
+}
+
+void LogArguments::append( const Argument& arg, MessageBuffer& out) {
+	switch( arg.type) {
+	case AT_signed:
+		appendNumber( out, arg.s);
+		break;
+	case AT_unsigned:
+		appendNumber( out, arg.u);
+		break;
+	case AT_double:
+		appendNumber( out, arg.d);
+		break;
+	case AT_pointer:
+		appendNumber( out, reinterpret_cast<const void*>(static_cast<std::uintptr_t>(arg.u)));
+		break;
+	case AT_string:
+	case AT_char:
+	case AT_prefix:
+		out.append( arg.str, arg.len);
+		break;
+	case AT_bool:
+		arg.u ? out.append( "true", 4) : out.append( "false", 5);
+		break;
+	}
+}
+
+void LogArguments::format( const char* format, const char* args, std::size_t len, MessageBuffer& out) {
+	const char* end = args + len;
+	const char* text = format;
+	bool complete = true;
+	Argument arg;
+	const char* first = args;
+	if( decode( first, end, arg) && arg.type == AT_prefix) {
+		append( arg, out);
+		args = first;
+	}
+	for( const char* f = format; *f && complete; ++f) {
+		if( f[0] != '{' || f[1] != '}')
+			continue;
+		out.append( text, static_cast<std::size_t>(f - text));
+		text = f;
+		complete = decode( args, end, arg);
+		if( complete) {
+			append( arg, out);
+			text = ++f + 1;
+		}
+	}
+	out.append( text, std::strlen( text));
+
+	while( complete && decode( args, end, arg)) {
+		out.append( " ", 1);
+		append( arg, out);
+	}
+}
+
+LogRecord::LogRecord( LogLevel ll, const std::string& text, const std::string* fields /* = 0 */, long long time /* = 0 */)
+: ll( ll)
+, m_time( time ? time : LogClock::now())
+, m_site( 0)
+, m_arguments( 0)
+, m_text( &text)
+, m_fields( fields)
+, m_original( 0)
+, m_prefix( 0)
+, m_prefixLen( 0)
+, m_depth( 0) {}
+
+LogRecord::LogRecord( LogLevel ll, const LogSite& site, const std::string& arguments, long long time /* = 0 */, const std::string* fields /* = 0 */)
+: ll( ll)
+, m_time( time ? time : LogClock::now())
+, m_site( &site)
+, m_arguments( &arguments)
+, m_text( 0)
+, m_fields( fields)
+, m_original( 0)
+, m_prefix( 0)
+, m_prefixLen( 0)
+, m_depth( 0) {}
+
+LogRecord::LogRecord( const LogRecord& original, const std::string& text)
+: ll( original.ll)
+, m_time( original.m_time)
+, m_site( original.m_site)
+, m_arguments( 0)
+, m_text( &text)
+, m_fields( original.m_fields)
+, m_original( 0)
+, m_prefix( 0)
+, m_prefixLen( 0)
+, m_depth( 0) {}
+
+LogRecord::LogRecord( const LogRecord& original, const char* prefix, std::size_t len)
+: ll( original.ll)
+, m_time( original.m_time)
+, m_site( original.m_site)
+, m_arguments( 0)
+, m_text( 0)
+, m_fields( original.m_fields)
+, m_original( &original)
+, m_prefix( prefix)
+, m_prefixLen( len)
+, m_depth( original.m_depth + 1) {}
+
+const std::string& LogRecord::format() const {
+	if( m_original) {
+		// the prefixes of the records in between are not joined on their own
+		const LogRecord* rec = this;
+		for( ; rec->m_original && !rec->m_text; rec = rec->m_original)
+			formatted.append( rec->m_prefix, rec->m_prefixLen);
+		const std::string& text = rec->text();
+		formatted.append( text.data(), text.size());
+	} else {
+		LogArguments::format( m_site->format, m_arguments->data(), m_arguments->size(), formatted);
+	}
+	m_text = &formatted.str();
+	return *m_text;
+}
+
+std::size_t LogRecord::segments( iovec* parts) const {
+	if( !m_original || m_text || m_depth >= maxSegments) {
+		const std::string& text = this->text();
+		parts[0].iov_base = const_cast<char*>(text.data());
+		parts[0].iov_len = text.size();
+		return 1;
+	}
+	parts[0].iov_base = const_cast<char*>(m_prefix);
+	parts[0].iov_len = m_prefixLen;
+	return 1 + m_original->segments( parts + 1);
+}
+
+std::size_t LogRecord::size() const {
+	if( m_original && !m_text)
+		return m_prefixLen + m_original->size();
+	return text().size();
+}
+
+LogRecord::SharedText LogRecord::share() const {
+	if( !m_shared)
+		m_shared = std::make_shared<const std::string>( text());
+	return m_shared;
+}
@@ -0,0 +1,301 @@
+#ifndef LogRecord_h_
+#define LogRecord_h_
+
+#include "LogLevel.h"
+#include "LogClock.h"
+#include "stringify.h"
+#include "MessageBuffer.h"
+
+#include <sys/uio.h>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <cstddef>
+#include <cstring>
+#include <type_traits>
+
+/*!
+ * \file LogRecord.h
+ * \ingroup Logging
+ *
+ * This file should not be included directly, as it is provided by Log.h
+ * Provides LogRecord, the message passed along the output chain, and the
+ * binary encoding of the arguments of deferred messages.
+ */
+
+//! static description of a place logging with LOG_DEFERRED
+/*!
+ * Every LOG_DEFERRED statement holds one LogSite. Only a reference to it
+ * is passed with the message, so the format string is never copied.
+ */
+class LogSite {
+public:
+	/*!
+	 * \param format the format string, {} is replaced by the next argument
+	 * \param file the source file of the call site
+	 * \param line the line of the call site
+	 */
+	constexpr LogSite( const char* format, const char* file, unsigned line)
+	: format( format)
+	, file( file)
+	, line( line)
+	, m_id( 0) {}
+
+	//! number identifying the call site within the process, starting at 1
+	/*!
+	 * Assigned the first time it is asked for.
+	 */
+	unsigned id() const;
+
+	const char* const format;
+	const char* const file;
+	const unsigned line;
+
+private:
+	LogSite( const LogSite&);
+	LogSite& operator=( const LogSite&);
+
+	mutable std::atomic<unsigned> m_id;
+};
+
+//! binary encoding of the arguments of a deferred message
+/*!
+ * Each argument is stored as one type byte followed by its value in the
+ * byte order of the machine. Numbers take 8 bytes, strings a 4 byte length
+ * followed by the characters. Types which are no numbers, characters,
+ * strings or pointers are converted with LIB::stringify while logging.
+ *
+ * The same encoding holds the key/value fields of a message, as a string
+ * argument for the key followed by the value.
+ */
+namespace LogArguments {
+	//! the type byte of an encoded argument
+	enum ArgumentType {
+		AT_signed = 1,
+		AT_unsigned,
+		AT_double,
+		AT_string,
+		AT_char,
+		AT_bool,
+		AT_pointer,
+		AT_prefix		///< text put in front of the message, see LogContext
+	};
+
+	void encodeSigned( MessageBuffer& out, long long n);
+	void encodeUnsigned( MessageBuffer& out, unsigned long long n);
+	void encode( MessageBuffer& out, const char* str, std::size_t len);
+	//! text written before the formatted message, has to be the first argument
+	void encodePrefix( MessageBuffer& out, const std::string& prefix);
+
+	void encode( MessageBuffer& out, double n);
+	void encode( MessageBuffer& out, char c);
+	void encode( MessageBuffer& out, bool b);
+	void encode( MessageBuffer& out, const void* p);
+	inline void encode( MessageBuffer& out, float n) { encode( out, static_cast<double>(n)); }
+	inline void encode( MessageBuffer& out, long double n) { encode( out, static_cast<double>(n)); }
+	inline void encode( MessageBuffer& out, const std::string& str) { encode( out, str.data(), str.size()); }
+	inline void encode( MessageBuffer& out, const char* str) { encode( out, str, std::strlen( str)); }
+	inline void encode( MessageBuffer& out, char* str) { encode( out, str, std::strlen( str)); }
+
+	//! integers, keeping only the information whether they are signed
+	template<class T>
+	typename std::enable_if<std::is_integral<T>::value && std::is_signed<T>::value>::type
+	encode( MessageBuffer& out, T n) {
+		encodeSigned( out, n);
+	}
+
+	template<class T>
+	typename std::enable_if<std::is_integral<T>::value && !std::is_signed<T>::value>::type
+	encode( MessageBuffer& out, T n) {
+		encodeUnsigned( out, n);
+	}
+
+	//! object pointers are written as address
+	template<class T>
+	typename std::enable_if<!std::is_function<T>::value>::type encode( MessageBuffer& out, T* p) {
+		encode( out, static_cast<const void*>(p));
+	}
+
+	//! everything else is converted by LIB::stringify
+	template<class T>
+	typename std::enable_if<!std::is_arithmetic<T>::value && !std::is_pointer<T>::value && !std::is_array<T>::value>::type
+	encode( MessageBuffer& out, const T& item) {
+		encode( out, LIB::stringify( item));
+	}
+
+	//! a decoded argument
+	struct Argument {
+		ArgumentType type;
+		union {
+			long long s;			///< AT_signed
+			unsigned long long u;	///< AT_unsigned, AT_bool and the address of AT_pointer
+			double d;				///< AT_double
+		};
+		//! the characters of AT_string and AT_char, pointing into the encoded arguments
+		const char* str;
+		std::size_t len;
+	};
+
+	//! decodes the next argument and moves args behind it
+	/*!
+	 * \return false if there is no complete argument left
+	 */
+	bool decode( const char*& args, const char* end, Argument& arg);
+
+	//! appends arg as text, like LogWriter would write it
+	void append( const Argument& arg, MessageBuffer& out);
+
+	//! replaces the {} in format by the encoded arguments
+	/*!
+	 * Arguments left over after the last {} are appended separated by
+	 * spaces. Formatting stops at a truncated or unknown argument. A leading
+	 * AT_prefix argument is written in front of the message.
+	 *
+	 * \param format the format string of the call site
+	 * \param args the encoded arguments
+	 * \param len the number of bytes in args
+	 * \param out the buffer the message is appended to
+	 */
+	void format( const char* format, const char* args, std::size_t len, MessageBuffer& out);
+} // namespace LogArguments
+
+//! a log message on its way through the output chain
+/*!
+ * A LogRecord refers to the text assembled by LogWriter, or for messages
+ * logged with LOG_DEFERRED to the call site and the encoded arguments.
+ * Deferred messages are formatted when text() is called first, so links
+ * which do not need the text (see binaryFileChainLink) never format them,
+ * and in asynchronous mode formatting happens on the background thread.
+ *
+ * Records do not own the strings they refer to and only live while the
+ * message is passed along the output chain.
+ *
+ * Links decorating the message for the following links (see taggingChainLink)
+ * create a record putting a prefix in front of the original one, without
+ * copying its text. Links able to write several parts at once write the
+ * segments() of a record, the others get them joined into one string by
+ * text(), once for all links. Links keeping messages beyond the call can
+ * share() one copy of the text.
+ */
+class LogRecord {
+public:
+	//! a message formatted by LogWriter
+	/*!
+	 * \param ll the log level of the message
+	 * \param text the text of the message
+	 * \param fields the encoded key/value fields, 0 if there are none
+	 * \param time when the message was logged, 0 for now (see LogClock::now())
+	 */
+	LogRecord( LogLevel ll, const std::string& text, const std::string* fields = 0, long long time = 0);
+
+	//! a message of LOG_DEFERRED, formatted on demand
+	LogRecord( LogLevel ll, const LogSite& site, const std::string& arguments, long long time = 0, const std::string* fields = 0);
+
+	//! a copy of original with a different text
+	/*!
+	 * Used by links modifying the message for the following links.
+	 */
+	LogRecord( const LogRecord& original, const std::string& text);
+
+	//! the text of original following a prefix
+	/*!
+	 * Neither the prefix nor the text of original is copied, both have to
+	 * live as long as the record.
+	 *
+	 * \param original the record to decorate
+	 * \param prefix the characters to put in front of the text
+	 * \param len the number of characters of prefix
+	 */
+	LogRecord( const LogRecord& original, const char* prefix, std::size_t len);
+
+	//! a copy of the text of a message, shared by the links keeping it
+	typedef std::shared_ptr<const std::string> SharedText;
+
+	//! the most parts segments() returns
+	static const std::size_t maxSegments = 8;
+
+	//! the log level of the message
+	LogLevel level() const { return ll; }
+
+	//! when the message was logged, in nanoseconds since the unix epoch
+	long long time() const { return m_time; }
+
+	//! the call site of a deferred message, 0 for other messages
+	const LogSite* site() const { return m_site; }
+
+	//! true if the message was logged with LOG_DEFERRED and not changed since
+	bool deferred() const { return m_arguments != 0; }
+
+	//! the encoded arguments of a deferred message
+	const std::string& arguments() const { return *m_arguments; }
+
+	//! the record this one puts a prefix in front of, 0 if it is not decorated
+	const LogRecord* original() const { return m_original; }
+
+	//! the characters put in front of original(), prefixSize() of them
+	const char* prefix() const { return m_prefix; }
+	std::size_t prefixSize() const { return m_prefixLen; }
+
+	//! the key/value fields added with LogWriter::kv(), empty if there are none
+	/*!
+	 * Encoded as pairs of a string argument holding the key and the value,
+	 * see LogArguments::decode().
+	 */
+	const std::string& fields() const { return m_fields ? *m_fields : noFields; }
+
+	//! the message text, formatted on the first call for deferred messages
+	const std::string& text() const {
+		return m_text ? *m_text : format();
+	}
+
+	//! the parts the text consists of, to be written with writev()
+	/*!
+	 * The prefixes of decorating records followed by the text of the
+	 * original message. Records decorated too often are joined by text().
+	 *
+	 * \param parts receives the parts, has to hold maxSegments elements
+	 * \return the number of parts
+	 */
+	std::size_t segments( iovec* parts) const;
+
+	//! the number of characters of the text
+	std::size_t size() const;
+
+	//! the text, copied once for all callers
+	/*!
+	 * For links which keep the text after the message was written.
+	 */
+	SharedText share() const;
+
+private:
+	// records refer to temporaries and must not outlive them
+	LogRecord( const LogRecord&);
+	LogRecord& operator=( const LogRecord&);
+
+	//! formats a deferred message or joins the segments of a decorated one
+	const std::string& format() const;
+
+	static const std::string noFields;
+
+	LogLevel ll;
+	long long m_time;
+	const LogSite* m_site;
+	//! encoded arguments if deferred, 0 otherwise
+	const std::string* m_arguments;
+	//! the text of the message, 0 until a deferred message is formatted
+	mutable const std::string* m_text;
+	//! the encoded fields, 0 if there are none
+	const std::string* m_fields;
+	//! the decorated record, 0 if there is no prefix
+	const LogRecord* m_original;
+	const char* m_prefix;
+	std::size_t m_prefixLen;
+	//! the number of records from this to the undecorated one
+	std::size_t m_depth;
+	//! holds the text of a deferred or decorated message
+	mutable MessageBuffer formatted;
+	//! the copy of share(), 0 until asked for
+	mutable SharedText m_shared;
+};
+
+#endif // LogRecord_h_
@@ -5,14 +5,24 @@
 
 LogWriter::LogWriter( Log* logger, LogLevel ll)
 : ll(ll)
-, logger( logger) {}
+, time( logger ? LogClock::now() : 0)
+, logger( logger)
+, contextSize( 0) {
+	if( !logger)
+		return;
+	if( const LogContext* context = LogContext::current()) {
+		buffer.append( context->prefix().data(), context->prefix().size());
+		fields.append( context->fields().data(), context->fields().size());
+		contextSize = buffer.size() + fields.size();
+	}
+}
 
 LogWriter::~LogWriter() {
-	if( buffer.size())
-		logger->log( ll, buffer);
+	if( logger && buffer.size() + fields.size() > contextSize)
+		logger->log( LogRecord( ll, buffer.str(), fields.size() ? &fields.str() : 0, time));
 }
 
 void LogWriter::append( const std::string& str) {
-	buffer += str;
+	buffer.append( str.data(), str.size());
 }
 
@@ -2,10 +2,14 @@
 #define LogWriter_h_
 
 #include "LogLevel.h"
+#include "LogRecord.h"
 #include "stringify.h"
+#include "MessageBuffer.h"
 
 #include <string>
 #include <utility>
+#include <cstring>
+#include <type_traits>
 
 /*!
  * \file LogWriter.h
@@ -27,8 +31,22 @@ class Log;
  *
  * A LogWriter is intended as a temporary cache for the parts of a log message.
  * It writes the cached string to the Log object when it is destructed.
+ * The message is assembled in a MessageBuffer, so that logging a typical
+ * message does not allocate memory.
  *
  * Only Log is allowed to create a LogWriter object. (through the Log::message() call)
+ *
+ * If no output link would write the message, Log::message() returns a
+ * disabled LogWriter, which ignores everything written to it.
+ *
+ * Besides the text, a message can carry typed key/value fields, which are
+ * passed to the output links unformatted (see LogRecord::fields()).
+ * \code
+ * logger.message(LL_info).kv("user", id).kv("latency_us", t) << "request done";
+ * \endcode
+ *
+ * The message starts with the prefix and the fields of the context of the
+ * thread, copied as they were formatted when the LogScope was entered.
  */
 class LogWriter {
 	friend class Log;
@@ -37,17 +55,45 @@ class LogWriter {
 public:
 	~LogWriter();
 
+	//! false if everything written to this LogWriter is discarded
+	/*!
+	 * Custom operator<< implementations can use this to skip expensive
+	 * preparation of their output.
+	 */
+	bool enabled() const { return logger != 0; }
+
+	//! add a key/value field to the message
+	/*!
+	 * Numbers, characters, strings and pointers keep their type, other
+	 * values are converted with LIB::stringify.
+	 *
+	 * \param key the name of the field
+	 * \param value the value of the field
+	 */
+	template<class T>
+	LogWriter&& kv( const char* key, const T& value) {
+		if( enabled()) {
+			LogArguments::encode( fields, key);
+			LogArguments::encode( fields, value);
+		}
+		return std::move( *this);
+	}
+
 private:
 	// hide, user should not copy the write
 	// internally the copy constructor is used when returning a
 	// new LogWriter from Log::message
 	LogWriter( const LogWriter& other)
 	 : buffer(other.buffer)
+	 , fields(other.fields)
 	 , ll(other.ll)
-	 , logger(other.logger) {}
+	 , time(other.time)
+	 , logger(other.logger)
+	 , contextSize(other.contextSize) {}
 
 	/*!
-	 * \param logger the Log object the LogWriter should write to
+	 * \param logger the Log object the LogWriter should write to,
+	 * 	0 creates a disabled LogWriter
 	 * \param ll the log level of the message held be LogWriter
 	 */
 	LogWriter( Log* logger, LogLevel ll);
@@ -60,12 +106,72 @@ private:
 	 */
 	void append( const std::string& str);
 
+	//! appends len characters starting at str
+	void append( const char* str, std::size_t len) { buffer.append( str, len); }
+
+	//! the other append() overloads format basic types directly into buffer
+	void append( const char* str) { append( str, std::strlen( str)); }
+	void append( char* str) { append( str, std::strlen( str)); }
+	void append( char c) { append( &c, 1); }
+	void append( bool b) { b ? append( "true", 4) : append( "false", 5); }
+	void append( unsigned char n) { appendNumber( static_cast<unsigned int>(n)); }
+	void append( short n) { appendNumber( n); }
+	void append( unsigned short n) { appendNumber( n); }
+	void append( int n) { appendNumber( n); }
+	void append( unsigned int n) { appendNumber( n); }
+	void append( long n) { appendNumber( n); }
+	void append( unsigned long n) { appendNumber( n); }
+	void append( long long n) { appendNumber( n); }
+	void append( unsigned long long n) { appendNumber( n); }
+	void append( float n) { appendNumber( n); }
+	void append( double n) { appendNumber( n); }
+	void append( long double n) { appendNumber( n); }
+	void append( const void* p) { appendNumber( p); }
+
+	//! object pointers are written as address
+	template<class T>
+	typename std::enable_if<!std::is_function<T>::value>::type append( T* p) {
+		appendNumber( static_cast<const void*>(p));
+	}
+
+	//! everything else is converted by LIB::stringify
+	template<class T>
+	void append( const T& item) {
+		append( LIB::stringify( item));
+	}
+
+	//! formats a number with LIB::to_chars directly into buffer
+	template<class T>
+	void appendNumber( T n) {
+		char* first = reserve( LIB::max_chars);
+		commit( LIB::to_chars( first, n));
+	}
+
+	//! makes room for at least len characters at the end of buffer
+	/*!
+	 * \return the first reserved character, to be passed to commit()
+	 * 	after writing
+	 */
+	char* reserve( std::size_t len) { return buffer.reserve( len); }
+
+	//! ends a write started with reserve()
+	/*!
+	 * \param end the character after the last written one
+	 */
+	void commit( char* end) { buffer.commit( end); }
+
 	//! the string to log
-	std::string buffer;
+	MessageBuffer buffer;
+	//! the encoded key/value fields
+	MessageBuffer fields;
 	//! log level of the message
 	LogLevel ll;
+	//! when the message was logged, see LogClock::now()
+	long long time;
 	//! the logger the message will be written to on destruction
 	Log* logger;
+	//! characters of buffer and fields taken by the context of the thread, see LogContext
+	std::size_t contextSize;
 };
 
 //! writes all basic types to the LogWriter
@@ -83,8 +189,60 @@ private:
  */
 template<class T>
 LogWriter&& operator<<( LogWriter&& out, const T& t_) {
-	out.append( LIB::stringify(t_));
+	if( out.enabled())
+		out.append( t_);
 	return std::forward<LogWriter>(out);
 }
 
+//! replacement for LogWriter for messages removed at compile time
+/*!
+ * Returned by Log::message<LogLevel>() for log levels more verbose than
+ * LOG_COMPILED_LEVEL. Everything written to it is discarded, and since
+ * operator<< is an empty inline template no code is emitted for it.
+ */
+class NullLogWriter {
+	friend class Log;
+public:
+	bool enabled() const { return false; }
+
+	template<class T>
+	NullLogWriter&& kv( const char* /* key */, const T& /* value */) { return std::move( *this); }
+private:
+	NullLogWriter() {}
+};
+
+//! discards everything written to a NullLogWriter
+template<class T>
+inline NullLogWriter&& operator<<( NullLogWriter&& out, const T& /* t_ */) {
+	return std::forward<NullLogWriter>(out);
+}
+
+//! selects the writer type for a log level known at compile time
+template<LogLevel ll, bool compiled = ( ll <= LOG_COMPILED_LEVEL)>
+struct StaticLogWriter {
+	typedef LogWriter type;
+};
+
+template<LogLevel ll>
+struct StaticLogWriter<ll, false> {
+	typedef NullLogWriter type;
+};
+
+//! helper for LOG_MESSAGE, turns a LogWriter expression into void
+struct LogWriterVoidify {
+	void operator&( LogWriter&&) {}
+};
+
+//! log a message, evaluating the arguments only if the message will be written
+/*!
+ * \code
+ * LOG_MESSAGE(logger, LL_debug) << "state: " << expensiveDump();
+ * \endcode
+ * expensiveDump() is not called if no output link accepts LL_debug.
+ * If ll is a constant more verbose than LOG_COMPILED_LEVEL, the whole
+ * statement is removed by the compiler.
+ */
+#define LOG_MESSAGE( log, ll) \
+	!( (ll) <= LOG_COMPILED_LEVEL && (log).enabled( ll)) ? (void)0 : LogWriterVoidify() & (log).message( ll)
+
 #endif // LogWriter_h_
@@ -0,0 +1,111 @@
+#include "MessageBuffer.h"
+
+#include <cstring>
+
+namespace {
+	//! strings with more capacity are not kept for the next message
+	const std::size_t maxArenaCapacity = 64 * 1024;
+
+	//! number of strings kept per thread
+	/*!
+	 * More than one is needed since output links like taggingChainLink
+	 * build a new message while the one of the LogWriter is still in use.
+	 */
+	const std::size_t arenaStrings = 4;
+
+	//! the strings shared by all MessageBuffers of a thread
+	struct Arena {
+		Arena() : inUse{} {}
+		std::string text[arenaStrings];
+		bool inUse[arenaStrings];
+	};
+
+	thread_local Arena arena;
+
+	std::string* acquire( bool& owned) {
+		for( std::size_t i = 0; i < arenaStrings; ++i) {
+			if( !arena.inUse[i]) {
+				owned = false;
+				arena.inUse[i] = true;
+				arena.text[i].clear();
+				return &arena.text[i];
+			}
+		}
+		owned = true;
+		return new std::string;
+	}
+
+	void release( std::string* str, bool owned) {
+		if( owned) {
+			delete str;
+			return;
+		}
+		if( str->capacity() > maxArenaCapacity)
+			std::string().swap( *str);
+		arena.inUse[str - arena.text] = false;
+	}
+} // namespace
+
+MessageBuffer::MessageBuffer()
+: used( 0)
+, spilled( 0)
+, ownsSpilled( false) {}
+
+MessageBuffer::MessageBuffer( const MessageBuffer& other)
+: used( 0)
+, spilled( 0)
+, ownsSpilled( false) {
+	if( other.spilled)
+		append( other.spilled->data(), other.spilled->size());
+	else
+		append( other.inlineData, other.used);
+}
+
+MessageBuffer::~MessageBuffer() {
+	if( spilled)
+		release( spilled, ownsSpilled);
+}
+
+void MessageBuffer::append( const char* str, std::size_t len) {
+	if( !spilled && used + len <= inlineSize) {
+		std::memcpy( inlineData + used, str, len);
+		used += len;
+		return;
+	}
+	if( !spilled)
+		spill( used + len);
+	spilled->append( str, len);
+}
+
+char* MessageBuffer::reserve( std::size_t len) {
+	if( !spilled && used + len <= inlineSize)
+		return inlineData + used;
+	if( !spilled)
+		spill( used + len);
+	std::size_t size = spilled->size();
+	spilled->resize( size + len);
+	return &(*spilled)[size];
+}
+
+void MessageBuffer::commit( char* end) {
+	if( spilled)
+		spilled->resize( static_cast<std::size_t>(end - spilled->data()));
+	else
+		used = static_cast<std::size_t>(end - inlineData);
+}
+
+std::size_t MessageBuffer::size() const {
+	return spilled ? spilled->size() : used;
+}
+
+const std::string& MessageBuffer::str() {
+	if( !spilled)
+		spill( used);
+	return *spilled;
+}
+
+void MessageBuffer::spill( std::size_t len) {
+	spilled = acquire( ownsSpilled);
+	spilled->reserve( len);
+	spilled->assign( inlineData, used);
+}
@@ -0,0 +1,74 @@
+#ifndef MessageBuffer_h_
+#define MessageBuffer_h_
+
+#include <string>
+#include <cstddef>
+
+/*!
+ * \file MessageBuffer.h
+ * \ingroup Logging
+ *
+ * This file should not be included directly, as it is provided by Log.h
+ * Provides the storage LogWriter assembles its message in
+ */
+
+//! character buffer which avoids heap allocations for log messages
+/*!
+ * Messages are assembled in a fixed size buffer inside the object. Longer
+ * messages are moved to one of a few strings which are kept per thread and
+ * reused by all messages of that thread, so they only allocate if a message
+ * is longer than all previous ones. Only if all of them are used by other
+ * MessageBuffers of the same thread (e.g. while logging from an output link)
+ * a string is allocated for the message.
+ */
+class MessageBuffer {
+public:
+	//! size of the buffer inside the object
+	static const std::size_t inlineSize = 256;
+
+	MessageBuffer();
+	MessageBuffer( const MessageBuffer& other);
+	~MessageBuffer();
+
+	//! appends len characters starting at str
+	void append( const char* str, std::size_t len);
+
+	//! makes room for at least len characters at the end of the buffer
+	/*!
+	 * \return the first reserved character, to be passed to commit()
+	 * 	after writing
+	 */
+	char* reserve( std::size_t len);
+
+	//! ends a write started with reserve()
+	/*!
+	 * \param end the character after the last written one
+	 */
+	void commit( char* end);
+
+	//! number of characters in the buffer
+	std::size_t size() const;
+
+	//! the contents of the buffer as string
+	/*!
+	 * The string is valid until the buffer is modified or destroyed.
+	 */
+	const std::string& str();
+
+private:
+	MessageBuffer& operator=( const MessageBuffer&);
+
+	//! move the contents to a string able to hold at least len characters
+	void spill( std::size_t len);
+
+	//! the buffer used for short messages
+	char inlineData[inlineSize];
+	//! number of characters in inlineData
+	std::size_t used;
+	//! holds the message once it got too long for inlineData, 0 before
+	std::string* spilled;
+	//! true if spilled was allocated instead of taken from the thread
+	bool ownsSpilled;
+};
+
+#endif // MessageBuffer_h_
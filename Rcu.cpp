@@ -0,0 +1,107 @@
+#include "Rcu.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace {
+	//! state of one reading thread
+	/*!
+	 * Readers are never freed, after the thread exited its Reader is reused
+	 * by the next thread starting to read.
+	 */
+	struct Reader {
+		Reader() : counter( 0), used( true), next( 0), nesting( 0) {}
+
+		//! incremented at the start and end of a read, odd while reading
+		std::atomic<unsigned long> counter;
+		//! true while a thread owns this Reader
+		std::atomic<bool> used;
+		//! next Reader in the registry
+		Reader* next;
+		//! number of nested ReadLocks, only used by the owning thread
+		unsigned nesting;
+		//! keeps the counters of different Readers on different cache lines
+		char padding[64];
+	};
+
+	//! all Readers ever created
+	std::atomic<Reader*> readers( 0);
+
+	Reader* acquireReader() {
+		for( Reader* r = readers.load( std::memory_order_acquire); r; r = r->next) {
+			bool unused = false;
+			if( !r->used.load( std::memory_order_relaxed)
+					&& r->used.compare_exchange_strong( unused, true))
+				return r;
+		}
+
+		Reader* r = new Reader;
+		r->next = readers.load( std::memory_order_relaxed);
+		while( !readers.compare_exchange_weak( r->next, r, std::memory_order_release, std::memory_order_relaxed))
+			;
+		return r;
+	}
+
+	thread_local Reader* self = 0;
+
+	//! returns the Reader of the thread when the thread exits
+	struct ReaderRelease {
+		~ReaderRelease() {
+			if( self) {
+				self->used.store( false, std::memory_order_release);
+				self = 0;
+			}
+		}
+	};
+
+	thread_local ReaderRelease release;
+
+	Reader& reader() {
+		if( !self) {
+			self = acquireReader();
+			(void)&release;
+		}
+		return *self;
+	}
+} // namespace
+
+Rcu::ReadLock::ReadLock() {
+	Reader& r = reader();
+	if( r.nesting++)
+		return;
+	r.counter.store( r.counter.load( std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+	// the counter has to be visible before the shared data is read
+	std::atomic_thread_fence( std::memory_order_seq_cst);
+}
+
+Rcu::ReadLock::~ReadLock() {
+	Reader& r = *self;
+	if( --r.nesting)
+		return;
+	r.counter.store( r.counter.load( std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+void Rcu::synchronize() {
+	// pairs with the fence in ReadLock, either the reader sees the new
+	// data or we see the reader
+	std::atomic_thread_fence( std::memory_order_seq_cst);
+
+	std::vector<std::pair<Reader*, unsigned long>> active;
+	for( Reader* r = readers.load( std::memory_order_acquire); r; r = r->next) {
+		unsigned long counter = r->counter.load( std::memory_order_acquire);
+		if( counter & 1)
+			active.push_back( std::make_pair( r, counter));
+	}
+
+	for( auto& a : active) {
+		for( unsigned spins = 0; a.first->counter.load( std::memory_order_acquire) == a.second; ++spins) {
+			if( spins > 100)
+				std::this_thread::yield();
+		}
+	}
+}
+
+bool Rcu::reading() {
+	return self && self->nesting;
+}
@@ -0,0 +1,56 @@
+#ifndef Rcu_h_
+#define Rcu_h_
+
+/*!
+ * \file Rcu.h
+ * \ingroup Logging
+ *
+ * This file should not be included directly, as it is provided by Log.h
+ * Provides the read-copy-update synchronization used to replace output chains
+ */
+
+//! read-copy-update synchronization
+/*!
+ * Readers enclose their access to shared data in a ReadLock. Writers
+ * publish a new version of the data through an atomic pointer and call
+ * synchronize() before deleting the old version. synchronize() returns once
+ * every ReadLock that could still see the old version was released.
+ *
+ * A ReadLock only writes to a counter owned by the calling thread, so
+ * readers do not contend with each other. ReadLocks may be nested.
+ *
+ * \code
+ * {
+ *    Rcu::ReadLock lock;
+ *    data* d = shared.load();
+ *    ... use d ...
+ * }
+ *
+ * data* old = shared.exchange( replacement);
+ * Rcu::synchronize();
+ * delete old;
+ * \endcode
+ */
+class Rcu {
+public:
+	//! marks the calling thread as reader while it exists
+	class ReadLock {
+	public:
+		ReadLock();
+		~ReadLock();
+	private:
+		ReadLock( const ReadLock&);
+		ReadLock& operator=( const ReadLock&);
+	};
+
+	//! wait until all ReadLocks existing at the time of the call are released
+	/*!
+	 * Must not be called while the calling thread holds a ReadLock.
+	 */
+	static void synchronize();
+
+	//! true while the calling thread holds a ReadLock
+	static bool reading();
+};
+
+#endif // Rcu_h_
@@ -0,0 +1,75 @@
+#ifndef bench_h_
+#define bench_h_
+
+#include "../Log.h"
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/*!
+ * \file bench.h
+ * \ingroup Logging
+ *
+ * Minimal benchmark harness used by log_bench.
+ * A benchmark is a function running the measured code a given number of
+ * times. The harness increases the number of iterations until the run
+ * takes long enough to be measured and reports the time and the number of
+ * memory allocations per iteration, including those for setting up the run.
+ * Benchmarks timing single operations can report them with
+ * recordLatencies(), the harness then prints their percentiles too.
+ *
+ * \code
+ * BENCHMARK(format_int) {
+ *    for( std::size_t i = 0; i < iterations; ++i)
+ *       ...
+ * }
+ * \endcode
+ */
+
+namespace bench {
+	//! a benchmark function, running the measured code iterations times
+	typedef void (*Function)( std::size_t iterations);
+
+	//! registers a benchmark at static initialization, used by BENCHMARK
+	struct Registration {
+		Registration( const char* name, Function function);
+	};
+
+	//! add latencies of single operations, in nanoseconds, of the current run
+	/*!
+	 * May be called by several threads.
+	 */
+	void recordLatencies( const std::vector<double>& nanoseconds);
+
+	//! prevent the compiler from optimizing away the computation of value
+	template<class T>
+	inline void doNotOptimize( const T& value) {
+		asm volatile( "" : : "r,m"(value) : "memory");
+	}
+
+	//! an output link which discards all messages
+	class nullChainLink : public outputChain {
+	public:
+		/*!
+		 * \param minimumLL the minimal log level which should be logged
+		 * \param threadSafe false to let outputChain lock around real_log
+		 * \param nextLink the next output link
+		 */
+		nullChainLink( LogLevel minimumLL, bool threadSafe = false, outputChain* nextLink = 0)
+		: outputChain( minimumLL, true, nextLink) {
+			setThreadSafe( threadSafe);
+		}
+	protected:
+		void real_log( LogLevel /* ll */, const std::string& str) {
+			doNotOptimize( str.size());
+		}
+	};
+} // namespace bench
+
+#define BENCHMARK( name) \
+	static void name( std::size_t iterations); \
+	static bench::Registration name##_registration( #name, name); \
+	static void name( std::size_t iterations)
+
+#endif // bench_h_
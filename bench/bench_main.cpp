@@ -0,0 +1,94 @@
+#include "bench.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <new>
+#include <vector>
+#include <utility>
+
+namespace {
+	//! number of calls to operator new during the current run
+	std::atomic<unsigned long long> allocations( 0);
+	//! set while the harness itself allocates on a thread
+	thread_local bool harnessAllocating = false;
+} // namespace
+
+void* operator new( std::size_t size) {
+	if( !harnessAllocating)
+		allocations.fetch_add( 1, std::memory_order_relaxed);
+	if( void* p = std::malloc( size ? size : 1))
+		return p;
+	throw std::bad_alloc();
+}
+
+void operator delete( void* p) noexcept {
+	std::free( p);
+}
+
+namespace {
+	std::vector<std::pair<const char*, bench::Function>>& registry() {
+		static std::vector<std::pair<const char*, bench::Function>> benchmarks;
+		return benchmarks;
+	}
+
+	std::mutex m_latencies;
+	std::vector<double> latencies;
+
+	//! the latency below which the given fraction of all latencies is
+	double percentile( double fraction) {
+		std::size_t i = static_cast<std::size_t>( fraction * static_cast<double>(latencies.size() - 1));
+		return latencies[i];
+	}
+
+	double run( bench::Function function, std::size_t iterations) {
+		latencies.clear();
+		allocations.store( 0);
+		auto start = std::chrono::steady_clock::now();
+		function( iterations);
+		return std::chrono::duration<double>( std::chrono::steady_clock::now() - start).count();
+	}
+} // namespace
+
+void bench::recordLatencies( const std::vector<double>& nanoseconds) {
+	std::lock_guard<std::mutex> lk(m_latencies);
+	harnessAllocating = true;
+	latencies.insert( latencies.end(), nanoseconds.begin(), nanoseconds.end());
+	harnessAllocating = false;
+}
+
+bench::Registration::Registration( const char* name, Function function) {
+	registry().push_back( std::make_pair( name, function));
+}
+
+//! runs all benchmarks, or those containing argv[1] in their name
+int main( int argc, char* argv[]) {
+	if( argc > 2)
+		return 1;
+
+	std::printf( "%-40s %12s %12s %12s %10s %10s %10s %10s\n", "benchmark", "iterations", "ns/iter", "allocs/iter", "p50", "p99", "p99.9", "max");
+	for( auto& benchmark : registry()) {
+		if( argc == 2 && !std::strstr( benchmark.first, argv[1]))
+			continue;
+
+		std::size_t iterations = 1;
+		double seconds = run( benchmark.second, iterations);
+		while( seconds < 0.2 && iterations < (std::size_t(1) << 40)) {
+			iterations *= seconds < 0.01 ? 10 : 2;
+			seconds = run( benchmark.second, iterations);
+		}
+		double perIteration = 1.0 / static_cast<double>(iterations);
+		std::printf( "%-40s %12zu %12.1f %12.3f", benchmark.first, iterations, seconds * 1e9 * perIteration,
+			static_cast<double>( allocations.load()) * perIteration);
+		if( !latencies.empty()) {
+			std::sort( latencies.begin(), latencies.end());
+			std::printf( " %10.0f %10.0f %10.0f %10.0f", percentile( 0.5), percentile( 0.99), percentile( 0.999), latencies.back());
+		}
+		std::printf( "\n");
+	}
+	return 0;
+}
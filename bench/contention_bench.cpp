@@ -0,0 +1,64 @@
+#include "bench.h"
+
+#include <thread>
+#include <vector>
+
+/*!
+ * Throughput of Log with 1 to 16 logging threads. The time per iteration
+ * is the wall clock time per message over all threads, so it drops with
+ * the number of threads as long as logging scales.
+ */
+
+namespace {
+	void logFromThreads( Log& log, std::size_t iterations, unsigned threads) {
+		std::vector<std::thread> writers;
+		for( unsigned t = 0; t < threads; ++t) {
+			writers.push_back( std::thread( [&log, iterations, threads, t] {
+				for( std::size_t i = t; i < iterations; i += threads)
+					log.message( LL_info) << "message " << i << " from thread " << t;
+			}));
+		}
+		for( auto& w : writers)
+			w.join();
+	}
+
+	//! a link locked by outputChain
+	void lockedSink( std::size_t iterations, unsigned threads) {
+		Log log;
+		log.setOutputChain( new bench::nullChainLink( LL_debug));
+		logFromThreads( log, iterations, threads);
+	}
+
+	//! a link declaring itself threadsafe, no lock is taken at all
+	void threadSafeSink( std::size_t iterations, unsigned threads) {
+		Log log;
+		log.setOutputChain( new bench::nullChainLink( LL_debug, true));
+		logFromThreads( log, iterations, threads);
+	}
+
+	//! a slow file link in front of a fast link, each with its own lock
+	void fileAndFastSink( std::size_t iterations, unsigned threads) {
+		Log log;
+		log.setOutputChain( new fileChainLink( "/dev/null", false, LL_debug, true,
+			new bench::nullChainLink( LL_debug, true)));
+		logFromThreads( log, iterations, threads);
+	}
+} // namespace
+
+BENCHMARK(contention_locked_1) { lockedSink( iterations, 1); }
+BENCHMARK(contention_locked_2) { lockedSink( iterations, 2); }
+BENCHMARK(contention_locked_4) { lockedSink( iterations, 4); }
+BENCHMARK(contention_locked_8) { lockedSink( iterations, 8); }
+BENCHMARK(contention_locked_16) { lockedSink( iterations, 16); }
+
+BENCHMARK(contention_threadsafe_1) { threadSafeSink( iterations, 1); }
+BENCHMARK(contention_threadsafe_2) { threadSafeSink( iterations, 2); }
+BENCHMARK(contention_threadsafe_4) { threadSafeSink( iterations, 4); }
+BENCHMARK(contention_threadsafe_8) { threadSafeSink( iterations, 8); }
+BENCHMARK(contention_threadsafe_16) { threadSafeSink( iterations, 16); }
+
+BENCHMARK(contention_file_and_fast_1) { fileAndFastSink( iterations, 1); }
+BENCHMARK(contention_file_and_fast_2) { fileAndFastSink( iterations, 2); }
+BENCHMARK(contention_file_and_fast_4) { fileAndFastSink( iterations, 4); }
+BENCHMARK(contention_file_and_fast_8) { fileAndFastSink( iterations, 8); }
+BENCHMARK(contention_file_and_fast_16) { fileAndFastSink( iterations, 16); }
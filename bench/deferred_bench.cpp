@@ -0,0 +1,61 @@
+#include "bench.h"
+
+#include <cstdio>
+
+/*!
+ * Cost of a message on the logging thread when it is formatted immediately
+ * with operator<< or deferred with LOG_DEFERRED, writing to a binary file
+ * which never formats deferred messages. The asynchronous benchmarks drop
+ * messages instead of waiting for the background thread, so they measure
+ * the cost on the logging thread only.
+ */
+
+namespace {
+	const char* filename = "deferred_bench.log";
+
+	template<class Function>
+	void logToBinaryFile( std::size_t iterations, Function function) {
+		{
+			Log log;
+			log.setOutputChain( new binaryFileChainLink( filename, LL_debug));
+			for( std::size_t i = 0; i < iterations; ++i)
+				function( log, i);
+		}
+		std::remove( filename);
+	}
+} // namespace
+
+BENCHMARK(deferred_null_stream) {
+	Log log;
+	log.setOutputChain( new bench::nullChainLink( LL_debug));
+	for( std::size_t i = 0; i < iterations; ++i)
+		log.message( LL_info) << "order " << i << " filled at " << 0.25 * static_cast<double>(i) << " by " << "trader";
+}
+
+BENCHMARK(deferred_async_stream) {
+	Log log;
+	log.setOutputChain( new bench::nullChainLink( LL_debug));
+	log.startAsync( 4096, OP_dropNewest);
+	for( std::size_t i = 0; i < iterations; ++i)
+		log.message( LL_info) << "order " << i << " filled at " << 0.25 * static_cast<double>(i) << " by " << "trader";
+}
+
+BENCHMARK(deferred_async_deferred) {
+	Log log;
+	log.setOutputChain( new bench::nullChainLink( LL_debug));
+	log.startAsync( 4096, OP_dropNewest);
+	for( std::size_t i = 0; i < iterations; ++i)
+		LOG_DEFERRED( log, LL_info, "order {} filled at {} by {}", i, 0.25 * static_cast<double>(i), "trader");
+}
+
+BENCHMARK(deferred_binary_stream) {
+	logToBinaryFile( iterations, []( Log& log, std::size_t i) {
+		log.message( LL_info) << "order " << i << " filled at " << 0.25 * static_cast<double>(i) << " by " << "trader";
+	});
+}
+
+BENCHMARK(deferred_binary_deferred) {
+	logToBinaryFile( iterations, []( Log& log, std::size_t i) {
+		LOG_DEFERRED( log, LL_info, "order {} filled at {} by {}", i, 0.25 * static_cast<double>(i), "trader");
+	});
+}
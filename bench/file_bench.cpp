@@ -0,0 +1,29 @@
+#include "bench.h"
+
+#include <cstdio>
+#include <chrono>
+
+/*!
+ * Lines per second written by fileChainLink, writing every message
+ * immediately or collecting them with setBuffering().
+ */
+
+namespace {
+	const char* filename = "file_bench.log";
+
+	void logToFile( std::size_t iterations, std::size_t bufferSize) {
+		{
+			Log log;
+			auto file = new fileChainLink( filename, true, LL_debug);
+			file->setBuffering( bufferSize, std::chrono::milliseconds(100), LL_error);
+			log.setOutputChain( file);
+			for( std::size_t i = 0; i < iterations; ++i)
+				log.message( LL_info) << "request " << i << " handled in " << i % 1000 << "us";
+		}
+		std::remove( filename);
+	}
+} // namespace
+
+BENCHMARK(file_unbuffered) { logToFile( iterations, 0); }
+BENCHMARK(file_buffered_4k) { logToFile( iterations, 4 * 1024); }
+BENCHMARK(file_buffered_64k) { logToFile( iterations, 64 * 1024); }
@@ -0,0 +1,62 @@
+#include "bench.h"
+
+/*!
+ * Cost of a message which no link would write, compared with the check of
+ * enabled() alone. Messages of disabled levels should cost no more than
+ * the level check, whatever their arguments.
+ */
+
+namespace {
+	const double ratio = 0.7182818;
+
+	//! a log writing only warnings and more severe messages
+	struct WarningLog {
+		WarningLog() {
+			log.setOutputChain( new bench::nullChainLink( LL_warning));
+		}
+
+		Log log;
+	};
+} // namespace
+
+BENCHMARK(level_enabled_check) {
+	WarningLog w;
+	for( std::size_t i = 0; i < iterations; ++i)
+		bench::doNotOptimize( w.log.enabled( LL_debug));
+}
+
+BENCHMARK(level_disabled_stream) {
+	WarningLog w;
+	for( std::size_t i = 0; i < iterations; ++i)
+		w.log.message( LL_debug) << "request " << i << " took " << static_cast<double>(i) * ratio << "ms";
+}
+
+BENCHMARK(level_disabled_fields) {
+	WarningLog w;
+	for( std::size_t i = 0; i < iterations; ++i)
+		w.log.message( LL_debug).kv( "request", i).kv( "ms", static_cast<double>(i) * ratio) << "request done";
+}
+
+BENCHMARK(level_disabled_deferred) {
+	WarningLog w;
+	for( std::size_t i = 0; i < iterations; ++i)
+		LOG_DEFERRED( w.log, LL_debug, "request {} took {}ms", i, static_cast<double>(i) * ratio);
+}
+
+//! messages below the minimum level of the only link, but enabled by a second one
+BENCHMARK(level_filtered_by_link) {
+	Log log;
+	log.setOutputChain( new bench::nullChainLink( LL_warning, false, new bench::nullChainLink( LL_info)));
+	for( std::size_t i = 0; i < iterations; ++i)
+		log.message( LL_info) << "request " << i;
+}
+
+//! a child logger disabled by its own level, while the output chain writes debug messages
+BENCHMARK(level_disabled_child) {
+	Log log;
+	log.setOutputChain( new bench::nullChainLink( LL_debug));
+	Log& child = log.child( "net.http");
+	log.setLevel( "net", LL_warning);
+	for( std::size_t i = 0; i < iterations; ++i)
+		LOG_MESSAGE( child, LL_debug) << "request " << i;
+}
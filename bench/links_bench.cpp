@@ -0,0 +1,103 @@
+#include "bench.h"
+
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+/*!
+ * Throughput of the output links for the same typical message, writing to
+ * /dev/null where a link writes to a file or stream. Every 8th message is
+ * timed for the percentiles.
+ */
+
+namespace {
+	const char* devNull = "/dev/null";
+	const double ratio = 0.7182818;
+	const std::size_t sampleEvery = 8;
+
+	void logThrough( std::size_t iterations, outputChain* chain, bufferingChainLink* buffer = 0) {
+		Log log;
+		log.setOutputChain( chain);
+		std::vector<double> latencies;
+		latencies.reserve( iterations / sampleEvery + 1);
+		for( std::size_t i = 0; i < iterations; ++i) {
+			if( i % sampleEvery) {
+				log.message( LL_info) << "request " << i << " took " << static_cast<double>(i) * ratio << "ms";
+				continue;
+			}
+			auto start = std::chrono::steady_clock::now();
+			log.message( LL_info) << "request " << i << " took " << static_cast<double>(i) * ratio << "ms";
+			latencies.push_back( std::chrono::duration<double, std::nano>( std::chrono::steady_clock::now() - start).count());
+			// keep the memory of bufferingChainLink bounded
+			if( buffer && i % 4096 == 0)
+				buffer->clear();
+		}
+		bench::recordLatencies( latencies);
+	}
+
+	//! sends std::cout to /dev/null while it exists
+	class DiscardCout {
+	public:
+		DiscardCout()
+		: null( devNull)
+		, original( std::cout.rdbuf( null.rdbuf())) {}
+
+		~DiscardCout() {
+			std::cout.rdbuf( original);
+		}
+
+	private:
+		std::ofstream null;
+		std::streambuf* original;
+	};
+} // namespace
+
+BENCHMARK(links_null) {
+	logThrough( iterations, new bench::nullChainLink( LL_debug));
+}
+
+BENCHMARK(links_cout) {
+	DiscardCout discard;
+	logThrough( iterations, new coutChainLink( LL_debug));
+}
+
+BENCHMARK(links_file) {
+	logThrough( iterations, new fileChainLink( devNull, true, LL_debug));
+}
+
+BENCHMARK(links_file_buffered_64k) {
+	auto file = new fileChainLink( devNull, true, LL_debug);
+	file->setBuffering( 64 * 1024);
+	logThrough( iterations, file);
+}
+
+BENCHMARK(links_json) {
+	logThrough( iterations, new jsonFileChainLink( devNull, true, LL_debug));
+}
+
+BENCHMARK(links_buffering) {
+	auto buffer = new bufferingChainLink( LL_debug);
+	logThrough( iterations, buffer, buffer);
+}
+
+BENCHMARK(links_tagging_elapsed) {
+	logThrough( iterations, new taggingChainLink( new bench::nullChainLink( LL_debug)));
+}
+
+BENCHMARK(links_tagging_iso8601) {
+	logThrough( iterations, new taggingChainLink( new bench::nullChainLink( LL_debug), TF_iso8601, 6));
+}
+
+//! the file link writes the time and the message without joining them
+BENCHMARK(links_tagging_file) {
+	logThrough( iterations, new taggingChainLink( new fileChainLink( devNull, true, LL_debug)));
+}
+
+//! a message passing eight links, half of which filter it
+BENCHMARK(links_chain_8) {
+	outputChain* chain = 0;
+	for( int i = 0; i < 8; ++i)
+		chain = new bench::nullChainLink( i % 2 ? LL_error : LL_debug, true, chain);
+	logThrough( iterations, chain);
+}
@@ -0,0 +1,44 @@
+#include "bench.h"
+
+#include <chrono>
+#include <thread>
+#include <vector>
+
+/*!
+ * Asynchronous logging from 1 to 64 threads. The time per iteration is the
+ * wall clock time per message over all threads, the percentiles are the
+ * time a single message takes on its logging thread.
+ */
+
+namespace {
+	void logFromThreads( std::size_t iterations, unsigned threads) {
+		Log log;
+		log.setOutputChain( new bench::nullChainLink( LL_debug, true));
+		log.startAsync( 1024);
+
+		std::vector<std::thread> writers;
+		for( unsigned t = 0; t < threads; ++t) {
+			writers.push_back( std::thread( [&log, iterations, threads, t] {
+				std::vector<double> latencies;
+				latencies.reserve( iterations / threads + 1);
+				for( std::size_t i = t; i < iterations; i += threads) {
+					auto start = std::chrono::steady_clock::now();
+					log.message( LL_info) << "message " << i << " from thread " << t;
+					latencies.push_back( std::chrono::duration<double, std::nano>( std::chrono::steady_clock::now() - start).count());
+				}
+				bench::recordLatencies( latencies);
+			}));
+		}
+		for( auto& w : writers)
+			w.join();
+		log.flush();
+	}
+} // namespace
+
+BENCHMARK(producers_1) { logFromThreads( iterations, 1); }
+BENCHMARK(producers_2) { logFromThreads( iterations, 2); }
+BENCHMARK(producers_4) { logFromThreads( iterations, 4); }
+BENCHMARK(producers_8) { logFromThreads( iterations, 8); }
+BENCHMARK(producers_16) { logFromThreads( iterations, 16); }
+BENCHMARK(producers_32) { logFromThreads( iterations, 32); }
+BENCHMARK(producers_64) { logFromThreads( iterations, 64); }
@@ -0,0 +1,89 @@
+#include "bench.h"
+
+#include <sstream>
+#include <string>
+
+/*!
+ * Compares the stream based conversion LogWriter used before with the
+ * LIB::to_chars functions which write directly into the message buffer.
+ */
+
+namespace {
+	//! the conversion LIB::stringify used for all numbers before to_chars
+	template<typename T>
+	std::string streamed( const T& item) {
+		std::ostringstream s;
+		s << item;
+		return s.str();
+	}
+
+	const double ratio = 0.7182818;
+} // namespace
+
+BENCHMARK(stringify_stream_int) {
+	std::string buffer;
+	for( std::size_t i = 0; i < iterations; ++i) {
+		buffer.clear();
+		buffer += streamed( static_cast<int>(i));
+		bench::doNotOptimize( buffer);
+	}
+}
+
+BENCHMARK(stringify_to_chars_int) {
+	char buffer[LIB::max_chars];
+	for( std::size_t i = 0; i < iterations; ++i)
+		bench::doNotOptimize( LIB::to_chars( buffer, static_cast<int>(i)));
+}
+
+BENCHMARK(stringify_stream_double) {
+	std::string buffer;
+	for( std::size_t i = 0; i < iterations; ++i) {
+		buffer.clear();
+		buffer += streamed( static_cast<double>(i) * ratio);
+		bench::doNotOptimize( buffer);
+	}
+}
+
+BENCHMARK(stringify_to_chars_double) {
+	char buffer[LIB::max_chars];
+	for( std::size_t i = 0; i < iterations; ++i)
+		bench::doNotOptimize( LIB::to_chars( buffer, static_cast<double>(i) * ratio));
+}
+
+BENCHMARK(stringify_stream_pointer) {
+	std::string buffer;
+	for( std::size_t i = 0; i < iterations; ++i) {
+		buffer.clear();
+		buffer += streamed( static_cast<const void*>(&buffer + i));
+		bench::doNotOptimize( buffer);
+	}
+}
+
+BENCHMARK(stringify_to_chars_pointer) {
+	std::string buffer;
+	char chars[LIB::max_chars];
+	for( std::size_t i = 0; i < iterations; ++i)
+		bench::doNotOptimize( LIB::to_chars( chars, static_cast<const void*>(&buffer + i)));
+}
+
+//! a typical message assembled like LogWriter did before
+BENCHMARK(stringify_stream_message) {
+	std::string buffer;
+	for( std::size_t i = 0; i < iterations; ++i) {
+		buffer.clear();
+		buffer += streamed( "request ");
+		buffer += streamed( i);
+		buffer += streamed( " took ");
+		buffer += streamed( static_cast<double>(i) * ratio);
+		buffer += streamed( "ms");
+		bench::doNotOptimize( buffer);
+	}
+}
+
+//! the same message through LogWriter into a discarding link
+BENCHMARK(stringify_writer_message) {
+	Log log;
+	log.setOutputChain( new bench::nullChainLink( LL_debug));
+	for( std::size_t i = 0; i < iterations; ++i)
+		log.message( LL_info) << "request " << i << " took " << static_cast<double>(i) * ratio << "ms";
+}
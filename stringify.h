@@ -3,8 +3,154 @@
 
 #include <string>
 #include <sstream>
+#include <algorithm>
+#include <clocale>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#if __cplusplus >= 201703L
+#include <charconv>
+#endif
 namespace LIB {
 
+	//! maximal number of characters written by one of the to_chars functions
+	static const std::size_t max_chars = 48;
+
+	namespace stringify_internal {
+		//! "00" to "99", used to convert two digits at once
+		static const char digit_pairs[201] =
+			"00010203040506070809"
+			"10111213141516171819"
+			"20212223242526272829"
+			"30313233343536373839"
+			"40414243444546474849"
+			"50515253545556575859"
+			"60616263646566676869"
+			"70717273747576777879"
+			"80818283848586878889"
+			"90919293949596979899";
+
+		inline char* unsigned_to_chars( char* first, unsigned long long value) {
+			char tmp[20];
+			char* p = tmp + sizeof(tmp);
+			while( value >= 100) {
+				const char* pair = digit_pairs + 2 * (value % 100);
+				value /= 100;
+				*--p = pair[1];
+				*--p = pair[0];
+			}
+			if( value >= 10) {
+				const char* pair = digit_pairs + 2 * value;
+				*--p = pair[1];
+				*--p = pair[0];
+			} else {
+				*--p = static_cast<char>('0' + value);
+			}
+			std::size_t n = static_cast<std::size_t>(tmp + sizeof(tmp) - p);
+			std::memcpy( first, p, n);
+			return first + n;
+		}
+
+		inline char* signed_to_chars( char* first, long long value) {
+			unsigned long long magnitude = static_cast<unsigned long long>(value);
+			if( value < 0) {
+				*first++ = '-';
+				magnitude = 0 - magnitude;
+			}
+			return unsigned_to_chars( first, magnitude);
+		}
+
+		//! replaces the decimal point of the C locale in the n characters snprintf wrote to first
+		inline char* classic_decimal_point( char* first, int n) {
+			char* last = first + ( n > 0 ? n : 0);
+			const char* point = std::localeconv()->decimal_point;
+			if( point[0] == '.' && !point[1])
+				return last;
+			std::size_t len = std::strlen( point);
+			char* found = std::search( first, last, point, point + len);
+			if( !len || found == last)
+				return last;
+			*found = '.';
+			std::memmove( found + 1, found + len, static_cast<std::size_t>(last - found) - len);
+			return last - ( len - 1);
+		}
+	} // namespace stringify_internal
+
+	//! locale independent conversion of numbers to text
+	/*!
+	 * The to_chars functions write the textual representation of value to
+	 * first, without terminating it, and return a pointer behind the last
+	 * written character. At most max_chars characters are written.
+	 * The output matches the default formatting of std::ostream.
+	 */
+	inline char* to_chars( char* first, unsigned long long value) {
+		return stringify_internal::unsigned_to_chars( first, value);
+	}
+	inline char* to_chars( char* first, unsigned long value) {
+		return stringify_internal::unsigned_to_chars( first, value);
+	}
+	inline char* to_chars( char* first, unsigned int value) {
+		return stringify_internal::unsigned_to_chars( first, value);
+	}
+	inline char* to_chars( char* first, unsigned short value) {
+		return stringify_internal::unsigned_to_chars( first, value);
+	}
+	inline char* to_chars( char* first, long long value) {
+		return stringify_internal::signed_to_chars( first, value);
+	}
+	inline char* to_chars( char* first, long value) {
+		return stringify_internal::signed_to_chars( first, value);
+	}
+	inline char* to_chars( char* first, int value) {
+		return stringify_internal::signed_to_chars( first, value);
+	}
+	inline char* to_chars( char* first, short value) {
+		return stringify_internal::signed_to_chars( first, value);
+	}
+
+	//! floating point numbers use the shortest of fixed or scientific notation with 6 digits
+	/*!
+	 * Before C++17 this falls back to snprintf, whose output gets the decimal
+	 * point of the C locale set with setlocale() replaced by '.'.
+	 */
+	inline char* to_chars( char* first, double value) {
+#if __cplusplus >= 201703L
+		return std::to_chars( first, first + max_chars, value, std::chars_format::general, 6).ptr;
+#else
+		return stringify_internal::classic_decimal_point( first, std::snprintf( first, max_chars, "%.*g", 6, value));
+#endif
+	}
+	inline char* to_chars( char* first, float value) {
+		return to_chars( first, static_cast<double>(value));
+	}
+	inline char* to_chars( char* first, long double value) {
+#if __cplusplus >= 201703L
+		return std::to_chars( first, first + max_chars, value, std::chars_format::general, 6).ptr;
+#else
+		return stringify_internal::classic_decimal_point( first, std::snprintf( first, max_chars, "%.*Lg", 6, value));
+#endif
+	}
+
+	//! pointers are written in hex with a leading 0x, null pointers as 0
+	inline char* to_chars( char* first, const void* value) {
+		std::uintptr_t v = reinterpret_cast<std::uintptr_t>(value);
+		if( !v) {
+			*first++ = '0';
+			return first;
+		}
+		char tmp[2 * sizeof(v)];
+		char* p = tmp + sizeof(tmp);
+		while( v) {
+			*--p = "0123456789abcdef"[v & 0xf];
+			v >>= 4;
+		}
+		*first++ = '0';
+		*first++ = 'x';
+		std::size_t n = static_cast<std::size_t>(tmp + sizeof(tmp) - p);
+		std::memcpy( first, p, n);
+		return first + n;
+	}
+
 	namespace stringify_internal {
 		template<typename T>
 		inline std::string real_stringify( const T& item) {
@@ -12,27 +158,56 @@ namespace LIB {
 			s << item;
 			return s.str();
 		}
-		
+
+		//! numbers are converted without a stream
+		template<typename T>
+		inline std::string number_stringify( T item) {
+			char buffer[max_chars];
+			return std::string( buffer, to_chars( buffer, item));
+		}
+
+		inline std::string real_stringify( const int& item) {
+			return number_stringify( item);
+		}
+		inline std::string real_stringify( const unsigned int& item) {
+			return number_stringify( item);
+		}
+		inline std::string real_stringify( const long& item) {
+			return number_stringify( item);
+		}
+		inline std::string real_stringify( const unsigned long& item) {
+			return number_stringify( item);
+		}
+		inline std::string real_stringify( const long long& item) {
+			return number_stringify( item);
+		}
+		inline std::string real_stringify( const unsigned long long& item) {
+			return number_stringify( item);
+		}
+		inline std::string real_stringify( const double& item) {
+			return number_stringify( item);
+		}
+
 		//! a string is good as it is
 		inline std::string real_stringify( const std::string& item) {
 			return item;
 		}
-		
+
 		//! interpret a signed char as a 'x' character
 		inline std::string real_stringify( const char& item) {
 			return std::string( 1, item);
 		}
-		
+
 		//! interpret an unsigned char as a number
 		inline std::string real_stringify( const unsigned char& item) {
 			return real_stringify((int)item);
 		}
-		
+
 		//! replace bools by their string 'equivalences'
 		inline std::string real_stringify( const bool& item) {
 			return ( item ? "true" : "false");
 		}
-		
+
 		//! interpret a char* as a c-string
 		inline std::string real_stringify( const char* const item) {
 			return std::string(item);
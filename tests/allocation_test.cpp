@@ -0,0 +1,112 @@
+#include <cppunit/extensions/HelperMacros.h>
+#include "../Log.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <string>
+
+//! number of calls to operator new in this program
+static std::atomic<unsigned long> allocations(0);
+
+void* operator new( std::size_t size) {
+   ++allocations;
+   if( void* p = std::malloc( size ? size : 1))
+      return p;
+   throw std::bad_alloc();
+}
+
+void operator delete( void* p) noexcept {
+   std::free( p);
+}
+
+//! an output link which only looks at the messages
+class countingChainLink : public outputChain {
+public:
+   countingChainLink( LogLevel minimumLL)
+   : outputChain( minimumLL, true, 0), count(0), length(0) {}
+
+   std::atomic<unsigned long> count;
+   std::atomic<std::size_t> length;
+
+protected:
+   void real_log( LogLevel /* ll */, const std::string& str) {
+      ++count;
+      length += str.size();
+   }
+};
+
+class allocation_test : public CppUnit::TestFixture
+{
+   CPPUNIT_TEST_SUITE(allocation_test);
+   CPPUNIT_TEST(shortMessages);
+   CPPUNIT_TEST(longMessages);
+   CPPUNIT_TEST(asyncMessages);
+   CPPUNIT_TEST(jsonFields);
+   CPPUNIT_TEST_SUITE_END();
+
+private:
+   Log* log;
+   countingChainLink* counter;
+
+   void logMessages( int n, const std::string& payload) {
+      for( int i = 0; i < n; ++i)
+         log->message(LL_info) << "message " << i << " ratio " << 0.5 * i << " " << payload.c_str();
+   }
+
+   //! allocations per message, after logging some messages to warm up
+   unsigned long allocationsPerMessages( const std::string& payload) {
+      logMessages( 64, payload);
+      log->flush();
+      unsigned long before = allocations;
+      logMessages( 100, payload);
+      log->flush();
+      return allocations - before;
+   }
+
+public:
+   void setUp()
+   {
+      log = new Log;
+      counter = new countingChainLink(LL_debug);
+      log->setOutputChain( new taggingChainLink( counter));
+   }
+
+   void tearDown()
+   {
+      delete log;
+   }
+
+   void shortMessages()
+   {
+      CPPUNIT_ASSERT_EQUAL( 0ul, allocationsPerMessages( "short"));
+      CPPUNIT_ASSERT_EQUAL( 164ul, counter->count.load());
+   }
+
+   void longMessages()
+   {
+      std::string payload( 3 * MessageBuffer::inlineSize, 'x');
+      CPPUNIT_ASSERT_EQUAL( 0ul, allocationsPerMessages( payload));
+      CPPUNIT_ASSERT( counter->length > 164 * payload.size());
+   }
+
+   void asyncMessages()
+   {
+      log->startAsync( 16);
+      CPPUNIT_ASSERT_EQUAL( 0ul, allocationsPerMessages( "short"));
+      CPPUNIT_ASSERT_EQUAL( 0ul, allocationsPerMessages( std::string( 1000, 'x')));
+   }
+
+   void jsonFields()
+   {
+      log->setOutputChain( new jsonFileChainLink( "/dev/null", false, LL_debug));
+      for( int i = 0; i < 64; ++i)
+         log->message(LL_info).kv("user", i).kv("name", "bob") << "request " << i;
+      unsigned long before = allocations;
+      for( int i = 0; i < 100; ++i)
+         log->message(LL_info).kv("user", i).kv("name", "bob") << "request " << i;
+      CPPUNIT_ASSERT_EQUAL( 0ul, allocations - before);
+   }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(allocation_test);
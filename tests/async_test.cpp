@@ -0,0 +1,183 @@
+#include <cppunit/extensions/HelperMacros.h>
+#include "../Log.h"
+
+#include <string>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <condition_variable>
+
+//! a link which blocks in real_log until it is opened
+class gateChainLink : public outputChain {
+public:
+   gateChainLink( outputChain* nextLink)
+   : outputChain( LL_debug, true, nextLink), entered(false), open(false) {}
+
+   void waitEntered() {
+      std::unique_lock<std::mutex> lk(m);
+      cv.wait( lk, [this] { return entered; });
+   }
+
+   void release() {
+      std::lock_guard<std::mutex> lk(m);
+      open = true;
+      cv.notify_all();
+   }
+
+protected:
+   void real_log( LogLevel /* ll */, const std::string& /* str */) {
+      std::unique_lock<std::mutex> lk(m);
+      entered = true;
+      cv.notify_all();
+      cv.wait( lk, [this] { return open; });
+   }
+
+private:
+   std::mutex m;
+   std::condition_variable cv;
+   bool entered;
+   bool open;
+};
+
+class async_test : public CppUnit::TestFixture
+{
+   CPPUNIT_TEST_SUITE(async_test);
+   CPPUNIT_TEST(ordered);
+   CPPUNIT_TEST(dropNewest);
+   CPPUNIT_TEST(dropByLevel);
+   CPPUNIT_TEST(drainOnStop);
+   CPPUNIT_TEST(threads);
+   CPPUNIT_TEST(threadsExit);
+   CPPUNIT_TEST_SUITE_END();
+
+public:
+   void ordered()
+   {
+      Log log;
+      auto buffer = new bufferingChainLink(LL_debug);
+      log.setOutputChain(buffer);
+      log.startAsync(4);
+
+      for( int i = 0; i < 100; ++i)
+         log.message(LL_info) << i;
+      log.flush();
+
+      auto messages = buffer->getMessages();
+      CPPUNIT_ASSERT_MESSAGE( "number", messages.size() == 100);
+      for( int i = 0; i < 100; ++i)
+         CPPUNIT_ASSERT_MESSAGE( "order", messages.at(i) == std::make_pair( LL_info, std::to_string(i)));
+      CPPUNIT_ASSERT_MESSAGE( "dropped", log.droppedMessages() == 0);
+   }
+
+   void dropNewest()
+   {
+      Log log;
+      auto buffer = new bufferingChainLink(LL_debug);
+      auto gate = new gateChainLink(buffer);
+      log.setOutputChain(gate);
+      log.startAsync(2, OP_dropNewest);
+
+      log.message(LL_info) << "in sink";
+      gate->waitEntered();
+      log.message(LL_info) << "queued 1";
+      log.message(LL_info) << "queued 2";
+      log.message(LL_error) << "dropped";
+      gate->release();
+      log.flush();
+
+      auto messages = buffer->getMessages();
+      CPPUNIT_ASSERT_MESSAGE( "number", messages.size() == 3);
+      CPPUNIT_ASSERT_MESSAGE( "last", messages.at(2).second == "queued 2");
+      CPPUNIT_ASSERT_MESSAGE( "dropped", log.droppedMessages() == 1);
+   }
+
+   void dropByLevel()
+   {
+      Log log;
+      auto buffer = new bufferingChainLink(LL_debug);
+      auto gate = new gateChainLink(buffer);
+      log.setOutputChain(gate);
+      log.startAsync(1, OP_dropByLevel, LL_info);
+
+      log.message(LL_info) << "in sink";
+      gate->waitEntered();
+      log.message(LL_info) << "queued";
+      log.message(LL_debug) << "dropped";
+      log.message(LL_info) << "dropped";
+      gate->release();
+      log.message(LL_error) << "kept";
+      log.flush();
+
+      auto messages = buffer->getMessages();
+      CPPUNIT_ASSERT_MESSAGE( "number", messages.size() == 3);
+      CPPUNIT_ASSERT_MESSAGE( "kept", messages.at(2) == std::make_pair( LL_error, std::string("kept")));
+      CPPUNIT_ASSERT_MESSAGE( "dropped", log.droppedMessages() == 2);
+   }
+
+   void drainOnStop()
+   {
+      bufferingChainLink::LogBuffer messages;
+      {
+         Log log;
+         auto buffer = new bufferingChainLink(LL_debug);
+         log.setOutputChain(buffer);
+         log.startAsync(16);
+         for( int i = 0; i < 10; ++i)
+            log.message(LL_info) << i;
+         log.stopAsync();
+         messages = buffer->getMessages();
+      }
+      CPPUNIT_ASSERT_MESSAGE( "number", messages.size() == 10);
+   }
+
+   //! messages of each thread keep their order
+   void threads()
+   {
+      Log log;
+      auto buffer = new bufferingChainLink(LL_debug);
+      log.setOutputChain(buffer);
+      log.startAsync(8);
+
+      const int threads = 4;
+      std::vector<std::thread> writers;
+      for( int t = 0; t < threads; ++t)
+         writers.push_back( std::thread( [&log, t] {
+            for( int i = 0; i < 1000; ++i)
+               log.message(LL_info) << t << ' ' << i;
+         }));
+      for( auto& w : writers)
+         w.join();
+      log.flush();
+
+      auto messages = buffer->getMessages();
+      CPPUNIT_ASSERT_MESSAGE( "number", messages.size() == threads * 1000);
+      int next[threads] = {};
+      for( auto& message : messages) {
+         int t = message.second[0] - '0';
+         CPPUNIT_ASSERT_MESSAGE( "order", message.second.substr(2) == std::to_string( next[t]++));
+      }
+   }
+
+   //! queues of exited threads are reused without losing messages
+   void threadsExit()
+   {
+      Log log;
+      auto buffer = new bufferingChainLink(LL_debug);
+      log.setOutputChain(buffer);
+      log.startAsync(4);
+
+      for( int t = 0; t < 20; ++t) {
+         std::thread( [&log, t] {
+            for( int i = 0; i < 10; ++i)
+               log.message(LL_info) << t << ' ' << i;
+         }).join();
+      }
+      log.flush();
+
+      auto messages = buffer->getMessages();
+      CPPUNIT_ASSERT_MESSAGE( "number", messages.size() == 200);
+      CPPUNIT_ASSERT_MESSAGE( "last", messages.back().second == "19 9");
+   }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(async_test);
@@ -0,0 +1,133 @@
+#include <cppunit/extensions/HelperMacros.h>
+#include "../Log.h"
+
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+   //! remembers for each message whether it decorates an unformatted deferred one
+   class deferredChainLink : public outputChain {
+   public:
+      deferredChainLink( outputChain* nextLink)
+      : outputChain( LL_debug, true, nextLink) {}
+
+      std::vector<bool> deferred;
+
+   protected:
+      void real_log( LogLevel /* ll */, const std::string& /* str */) {}
+
+      void real_logRecord( const LogRecord& rec) {
+         deferred.push_back( rec.original() && rec.original()->deferred());
+      }
+   };
+} // namespace
+
+class backtrace_test : public CppUnit::TestFixture
+{
+   CPPUNIT_TEST_SUITE(backtrace_test);
+   CPPUNIT_TEST(forwardedBeforeTrigger);
+   CPPUNIT_TEST(perThread);
+   CPPUNIT_TEST(deferred);
+   CPPUNIT_TEST(enabledLevels);
+   CPPUNIT_TEST(tagged);
+   CPPUNIT_TEST_SUITE_END();
+
+public:
+   void forwardedBeforeTrigger()
+   {
+      bufferingChainLink* context = new bufferingChainLink( LL_debug);
+      bufferingChainLink* always = new bufferingChainLink( LL_info, true, new backtraceChainLink( 4, LL_error, context));
+      Log log;
+      log.setOutputChain( always);
+      for( int i = 0; i < 6; ++i)
+         log.message(LL_debug) << "debug " << i;
+      log.message(LL_info) << "info";
+      CPPUNIT_ASSERT( context->getMessages().empty());
+
+      log.message(LL_error) << "error";
+      CPPUNIT_ASSERT_EQUAL( std::size_t(2), always->getMessages().size());
+      auto messages = context->getMessages();
+      CPPUNIT_ASSERT_EQUAL( std::size_t(5), messages.size());
+      CPPUNIT_ASSERT_EQUAL( std::string("debug 3"), messages[0].second);
+      CPPUNIT_ASSERT_EQUAL( std::string("debug 5"), messages[2].second);
+      CPPUNIT_ASSERT_EQUAL( std::string("info"), messages[3].second);
+      CPPUNIT_ASSERT( messages[3].first == LL_info);
+      CPPUNIT_ASSERT_EQUAL( std::string("error"), messages[4].second);
+
+      // forwarded messages are not repeated
+      context->clear();
+      log.message(LL_debug) << "after";
+      log.message(LL_critical) << "critical";
+      messages = context->getMessages();
+      CPPUNIT_ASSERT_EQUAL( std::size_t(2), messages.size());
+      CPPUNIT_ASSERT_EQUAL( std::string("after"), messages[0].second);
+      CPPUNIT_ASSERT_EQUAL( std::string("critical"), messages[1].second);
+   }
+
+   //! an error only brings the messages of its own thread
+   void perThread()
+   {
+      bufferingChainLink* context = new bufferingChainLink( LL_debug);
+      Log log;
+      log.setOutputChain( new backtraceChainLink( 8, LL_error, context));
+      std::thread other( [&log] { log.message(LL_debug) << "other thread"; });
+      other.join();
+      log.message(LL_debug) << "this thread";
+      log.message(LL_error) << "error";
+
+      auto messages = context->getMessages();
+      CPPUNIT_ASSERT_EQUAL( std::size_t(2), messages.size());
+      CPPUNIT_ASSERT_EQUAL( std::string("this thread"), messages[0].second);
+      CPPUNIT_ASSERT_EQUAL( std::string("error"), messages[1].second);
+   }
+
+   //! deferred messages are held back unformatted
+   void deferred()
+   {
+      bufferingChainLink* context = new bufferingChainLink( LL_debug);
+      Log log;
+      log.setOutputChain( new backtraceChainLink( 2, LL_warning, context));
+      LOG_DEFERRED( log, LL_info, "request {} took {} ms", 42, 17);
+      LOG_DEFERRED( log, LL_warning, "slow request {}", 42);
+
+      auto messages = context->getMessages();
+      CPPUNIT_ASSERT_EQUAL( std::size_t(2), messages.size());
+      CPPUNIT_ASSERT_EQUAL( std::string("request 42 took 17 ms"), messages[0].second);
+      CPPUNIT_ASSERT_EQUAL( std::string("slow request 42"), messages[1].second);
+   }
+
+   //! the levels of the following links are enabled
+   void enabledLevels()
+   {
+      Log log;
+      log.setOutputChain( new backtraceChainLink( 2, LL_error, new bufferingChainLink( LL_info)));
+      CPPUNIT_ASSERT( log.enabled( LL_info));
+      CPPUNIT_ASSERT( !log.enabled( LL_debug));
+      CPPUNIT_ASSERT_THROW( backtraceChainLink( 0), std::invalid_argument);
+   }
+
+   //! messages held back behind a tagging link keep their time and stay unformatted
+   void tagged()
+   {
+      bufferingChainLink* context = new bufferingChainLink( LL_debug);
+      Log log;
+      deferredChainLink* probe = new deferredChainLink( context);
+      log.setOutputChain( new taggingChainLink( new backtraceChainLink( 4, LL_error, probe), TF_elapsed, 1));
+      LOG_DEFERRED( log, LL_info, "deferred {}", 1);
+      log.message(LL_info) << "streamed";
+      log.message(LL_error) << "error";
+
+      auto messages = context->getMessages();
+      CPPUNIT_ASSERT_EQUAL( std::size_t(3), messages.size());
+      CPPUNIT_ASSERT_EQUAL( std::string("  0.0 deferred 1"), messages[0].second);
+      CPPUNIT_ASSERT_EQUAL( std::string("  0.0 streamed"), messages[1].second);
+      CPPUNIT_ASSERT_EQUAL( std::string("  0.0 error"), messages[2].second);
+      CPPUNIT_ASSERT_EQUAL( std::size_t(3), probe->deferred.size());
+      CPPUNIT_ASSERT( probe->deferred[0]);
+      CPPUNIT_ASSERT( !probe->deferred[1]);
+   }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(backtrace_test);
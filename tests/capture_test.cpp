@@ -0,0 +1,167 @@
+#include <cppunit/extensions/HelperMacros.h>
+#include "../Log.h"
+
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+   std::string contents( const char* filename) {
+      std::ifstream in( filename);
+      std::ostringstream s;
+      s << in.rdbuf();
+      return s.str();
+   }
+} // namespace
+
+class capture_test : public CppUnit::TestFixture
+{
+   CPPUNIT_TEST_SUITE(capture_test);
+   CPPUNIT_TEST(lastMessages);
+   CPPUNIT_TEST(truncate);
+   CPPUNIT_TEST(concurrent);
+   CPPUNIT_TEST(dump);
+   CPPUNIT_TEST(dumpOnCrash);
+   CPPUNIT_TEST_SUITE_END();
+
+private:
+   static const char* filename;
+
+public:
+   void tearDown()
+   {
+      std::remove( filename);
+   }
+
+   void lastMessages()
+   {
+      captureChainLink* capture = new captureChainLink( 4, 64, LL_info);
+      Log log;
+      log.setOutputChain( capture);
+      for( int i = 0; i < 10; ++i)
+         log.message( i % 2 ? LL_info : LL_error) << "message " << i;
+      log.message(LL_debug) << "not captured";
+
+      auto messages = capture->snapshot();
+      CPPUNIT_ASSERT_EQUAL( std::size_t(4), messages.size());
+      for( std::size_t i = 0; i < 4; ++i) {
+         CPPUNIT_ASSERT_EQUAL( 6ull + i, messages[i].sequence);
+         CPPUNIT_ASSERT_EQUAL( "message " + std::to_string( 6 + i), messages[i].text);
+         CPPUNIT_ASSERT( messages[i].ll == ( i % 2 ? LL_info : LL_error));
+         CPPUNIT_ASSERT( messages[i].time > 0);
+      }
+   }
+
+   void truncate()
+   {
+      captureChainLink* capture = new captureChainLink( 4, 10, LL_info);
+      Log log;
+      log.setOutputChain( capture);
+      log.message(LL_info) << "short";
+      log.message(LL_info) << "a message longer than ten characters";
+
+      auto messages = capture->snapshot();
+      CPPUNIT_ASSERT_EQUAL( std::size_t(2), messages.size());
+      CPPUNIT_ASSERT_EQUAL( std::string("short"), messages[0].text);
+      CPPUNIT_ASSERT_EQUAL( std::string("a message "), messages[1].text);
+   }
+
+   //! snapshots taken while threads log only hold complete messages
+   void concurrent()
+   {
+      captureChainLink* capture = new captureChainLink( 64, 64, LL_info);
+      Log log;
+      log.setOutputChain( capture);
+
+      std::atomic<bool> done( false);
+      std::atomic<int> bad( 0);
+      std::thread reader( [&] {
+         while( !done) {
+            auto messages = capture->snapshot();
+            for( std::size_t i = 0; i < messages.size(); ++i) {
+               if( i && messages[i].sequence <= messages[i - 1].sequence)
+                  ++bad;
+               const std::string& text = messages[i].text;
+               // "thread t message i ...", padded to check the whole text
+               if( text.size() != 40 || text.compare( 0, 7, "thread ") || text.back() != '.')
+                  ++bad;
+            }
+         }
+      });
+      std::vector<std::thread> writers;
+      for( int t = 0; t < 4; ++t) {
+         writers.push_back( std::thread( [&log, t] {
+            for( int i = 0; i < 2000; ++i) {
+               std::string text = "thread " + std::to_string( t) + " message " + std::to_string( i);
+               log.message(LL_info) << text << std::string( 40 - text.size() - 1, ' ') << '.';
+            }
+         }));
+      }
+      for( auto& w : writers)
+         w.join();
+      done = true;
+      reader.join();
+
+      CPPUNIT_ASSERT_EQUAL( 0, bad.load());
+      auto messages = capture->snapshot();
+      CPPUNIT_ASSERT_EQUAL( std::size_t(64), messages.size());
+      CPPUNIT_ASSERT_EQUAL( 8000ull - 64, messages[0].sequence);
+   }
+
+   void dump()
+   {
+      captureChainLink* capture = new captureChainLink( 2, 64, LL_info);
+      Log log;
+      log.setOutputChain( capture);
+      log.message(LL_info) << "first";
+      log.message(LL_warning) << "second";
+      log.message(LL_error) << "third";
+
+      int fd = ::open( filename, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+      capture->dump( fd);
+      ::close( fd);
+
+      // "1715933742.123456 warning second\n1715933742.123457 error third\n"
+      std::string dumped = contents( filename);
+      std::size_t line = dumped.find( '\n');
+      CPPUNIT_ASSERT( line != std::string::npos);
+      CPPUNIT_ASSERT_EQUAL( std::string(" warning second"), dumped.substr( line - 15, 15));
+      CPPUNIT_ASSERT_EQUAL( '.', dumped[line - 22]);
+      CPPUNIT_ASSERT_EQUAL( std::string(" error third\n"), dumped.substr( dumped.size() - 13));
+   }
+
+   //! a crashing process writes the captured messages
+   void dumpOnCrash()
+   {
+      pid_t child = ::fork();
+      if( !child) {
+         int fd = ::open( filename, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+         captureChainLink* capture = new captureChainLink( 8, 64, LL_info);
+         capture->dumpOnCrash( fd);
+         Log log;
+         log.setOutputChain( capture);
+         log.message(LL_info) << "before the crash";
+         ::raise( SIGSEGV);
+         ::_exit( 0);
+      }
+
+      int status;
+      ::waitpid( child, &status, 0);
+      CPPUNIT_ASSERT( WIFSIGNALED( status));
+      CPPUNIT_ASSERT_EQUAL( SIGSEGV, WTERMSIG( status));
+      std::string dumped = contents( filename);
+      CPPUNIT_ASSERT_EQUAL( std::string(" info before the crash\n"), dumped.substr( dumped.size() - 23));
+   }
+};
+
+const char* capture_test::filename = "capture_test.log";
+
+CPPUNIT_TEST_SUITE_REGISTRATION(capture_test);
@@ -0,0 +1,125 @@
+#include <cppunit/extensions/HelperMacros.h>
+#include "../Log.h"
+
+#include <chrono>
+#include <future>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+   //! remembers the timestamps of the messages, the first one waits for release
+   class stallingChainLink : public outputChain {
+   public:
+      stallingChainLink( std::shared_future<void> release)
+      : outputChain( LL_debug, true, 0)
+      , release( release) {}
+
+      std::vector<long long> times;
+
+   protected:
+      void real_log( LogLevel /* ll */, const std::string& /* str */) {}
+
+      void real_logRecord( const LogRecord& rec) {
+         if( times.empty())
+            release.wait();
+         times.push_back( rec.time());
+      }
+
+   private:
+      std::shared_future<void> release;
+   };
+
+   std::string formatted( long long time, TimeFormat format, unsigned digits, long long since = 0) {
+      char out[LogClock::maxFormatted];
+      return std::string( out, LogClock::format( out, time, format, digits, since));
+   }
+
+   const long long second = 1000000000;
+} // namespace
+
+class clock_test : public CppUnit::TestFixture
+{
+   CPPUNIT_TEST_SUITE(clock_test);
+   CPPUNIT_TEST(elapsed);
+   CPPUNIT_TEST(iso8601);
+   CPPUNIT_TEST(sources);
+   CPPUNIT_TEST(capturedWhenLogged);
+   CPPUNIT_TEST_SUITE_END();
+
+public:
+   void tearDown()
+   {
+      LogClock::setSource( CS_realtime);
+   }
+
+   void elapsed()
+   {
+      long long since = 1715933742 * second;
+      CPPUNIT_ASSERT_EQUAL( std::string("  0.000"), formatted( since, TF_elapsed, 3, since));
+      CPPUNIT_ASSERT_EQUAL( std::string(" 12.345"), formatted( since + 12345678901, TF_elapsed, 3, since));
+      CPPUNIT_ASSERT_EQUAL( std::string(" 12.346"), formatted( since + 12346000000, TF_elapsed, 3, since));
+      CPPUNIT_ASSERT_EQUAL( std::string("1234.5"), formatted( since + 1234567890123, TF_elapsed, 1, since));
+      // the cached seconds have to follow a different start
+      CPPUNIT_ASSERT_EQUAL( std::string("  2.000000"), formatted( since + 12 * second, TF_elapsed, 6, since + 10 * second));
+      CPPUNIT_ASSERT_EQUAL( std::string("  0.000"), formatted( since - second, TF_elapsed, 3, since));
+   }
+
+   void iso8601()
+   {
+      long long time = 1715933742 * second + 123456789;
+      CPPUNIT_ASSERT_EQUAL( std::string("2024-05-17T08:15:42.123Z"), formatted( time, TF_iso8601, 3));
+      CPPUNIT_ASSERT_EQUAL( std::string("2024-05-17T08:15:42.123456789Z"), formatted( time, TF_iso8601, 9));
+      CPPUNIT_ASSERT_EQUAL( std::string("2024-05-17T08:15:43.000001Z"), formatted( time + second - 123455789, TF_iso8601, 6));
+      CPPUNIT_ASSERT_EQUAL( std::string("2024-05-17T08:15:42Z"), formatted( time, TF_iso8601, 0));
+      CPPUNIT_ASSERT_EQUAL( std::string("1969-12-31T23:59:59.500Z"), formatted( -second / 2, TF_iso8601, 3));
+   }
+
+   //! all clock sources tell the system time
+   void sources()
+   {
+      const ClockSource sources[] = { CS_realtime, CS_realtimeCoarse, CS_monotonic, CS_tsc };
+      for( ClockSource source : sources) {
+         try {
+            LogClock::setSource( source);
+         } catch( const std::invalid_argument&) {
+            CPPUNIT_ASSERT( source == CS_tsc);
+            continue;
+         }
+         CPPUNIT_ASSERT( LogClock::source() == source);
+         long long system = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+         long long now = LogClock::now();
+         CPPUNIT_ASSERT( now > system - 50000000);
+         CPPUNIT_ASSERT( now < system + 50000000);
+         CPPUNIT_ASSERT( LogClock::now() >= now);
+      }
+   }
+
+   //! in asynchronous mode the time is taken by the logging thread
+   void capturedWhenLogged()
+   {
+      std::promise<void> release;
+      stallingChainLink* link = new stallingChainLink( release.get_future().share());
+      Log log;
+      log.setOutputChain( link);
+      log.startAsync( 16);
+
+      log.message(LL_info) << "first";
+      long long before = LogClock::now();
+      log.message(LL_info) << "second";
+      LOG_DEFERRED( log, LL_info, "third {}", 3);
+      long long after = LogClock::now();
+      std::this_thread::sleep_for( std::chrono::milliseconds(20));
+      release.set_value();
+      log.flush();
+
+      CPPUNIT_ASSERT_EQUAL( std::size_t(3), link->times.size());
+      for( std::size_t i = 1; i < 3; ++i) {
+         CPPUNIT_ASSERT( link->times[i] >= before);
+         CPPUNIT_ASSERT( link->times[i] <= after);
+      }
+   }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(clock_test);
@@ -0,0 +1,89 @@
+#include <cppunit/extensions/HelperMacros.h>
+#include "../Log.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+namespace {
+   //! counts the messages it gets
+   class counterChainLink : public outputChain {
+   public:
+      counterChainLink( outputChain* nextLink)
+      : outputChain( LL_debug, true, nextLink), count(0) {}
+
+      std::atomic<int> count;
+
+   protected:
+      void real_log( LogLevel /* ll */, const std::string& /* str */) {
+         ++count;
+      }
+   };
+
+   //! blocks in real_log until it is opened
+   class blockingChainLink : public outputChain {
+   public:
+      blockingChainLink()
+      : outputChain( LL_debug, true, 0), entered(false), open(false) {}
+
+      void waitEntered() {
+         std::unique_lock<std::mutex> lk(m);
+         cv.wait( lk, [this] { return entered; });
+      }
+
+      void release() {
+         std::lock_guard<std::mutex> lk(m);
+         open = true;
+         cv.notify_all();
+      }
+
+   protected:
+      void real_log( LogLevel /* ll */, const std::string& /* str */) {
+         std::unique_lock<std::mutex> lk(m);
+         entered = true;
+         cv.notify_all();
+         cv.wait( lk, [this] { return open; });
+      }
+
+   private:
+      std::mutex m;
+      std::condition_variable cv;
+      bool entered;
+      bool open;
+   };
+} // namespace
+
+class concurrency_test : public CppUnit::TestFixture
+{
+   CPPUNIT_TEST_SUITE(concurrency_test);
+   CPPUNIT_TEST(independentLinks);
+   CPPUNIT_TEST_SUITE_END();
+
+public:
+   //! a thread blocked in one link does not keep others from writing to another link
+   void independentLinks()
+   {
+      Log log;
+      auto slow = new blockingChainLink;
+      auto fast = new counterChainLink( slow);
+      log.setOutputChain( fast);
+
+      std::thread first( [&log] { log.message(LL_info) << "first"; });
+      slow->waitEntered();
+      std::thread second( [&log] { log.message(LL_info) << "second"; });
+
+      for( int i = 0; i < 1000 && fast->count < 2; ++i)
+         std::this_thread::sleep_for( std::chrono::milliseconds(1));
+      int written = fast->count;
+
+      slow->release();
+      first.join();
+      second.join();
+
+      CPPUNIT_ASSERT_EQUAL( 2, written);
+   }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(concurrency_test);
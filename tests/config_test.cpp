@@ -0,0 +1,247 @@
+#include <cppunit/extensions/HelperMacros.h>
+#include "../LogConfig.h"
+
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+   std::string contents( const std::string& filename) {
+      std::ifstream in( filename.c_str());
+      std::ostringstream s;
+      s << in.rdbuf();
+      return s.str();
+   }
+
+   std::size_t lines( const std::string& filename) {
+      std::string s = contents( filename);
+      return static_cast<std::size_t>( std::count( s.begin(), s.end(), '\n'));
+   }
+
+   //! replaces filename at once, like editors saving a file
+   void write( const std::string& filename, const std::string& text) {
+      std::string temporary = filename + ".tmp";
+      std::ofstream( temporary.c_str()) << text;
+      std::rename( temporary.c_str(), filename.c_str());
+   }
+
+   //! waits until the watcher installed the configuration n times
+   bool waitFor( const LogConfigWatcher& watcher, std::size_t n) {
+      for( int i = 0; i < 1000 && watcher.reloads() < n; ++i)
+         std::this_thread::sleep_for( std::chrono::milliseconds(2));
+      return watcher.reloads() >= n;
+   }
+
+   std::string error( const std::string& config) {
+      try {
+         std::istringstream in( config);
+         delete LogConfig::parse( in).buildChain();
+      } catch( const std::invalid_argument& e) {
+         return e.what();
+      }
+      return std::string();
+   }
+} // namespace
+
+class config_test : public CppUnit::TestFixture
+{
+   CPPUNIT_TEST_SUITE(config_test);
+   CPPUNIT_TEST(applied);
+   CPPUNIT_TEST(errors);
+   CPPUNIT_TEST(levels);
+   CPPUNIT_TEST(watched);
+   CPPUNIT_TEST(continued);
+   CPPUNIT_TEST(notTruncated);
+   CPPUNIT_TEST(sighup);
+   CPPUNIT_TEST_SUITE_END();
+
+private:
+   static const std::string filename;
+   static const std::string first;
+   static const std::string second;
+   static const std::string binary;
+   static const std::string ring;
+
+public:
+   void tearDown()
+   {
+      std::remove( filename.c_str());
+      std::remove( first.c_str());
+      std::remove( second.c_str());
+      std::remove( binary.c_str());
+      std::remove( ring.c_str());
+   }
+
+   void applied()
+   {
+      std::istringstream in(
+         "# comment\n"
+         "\n"
+         "async capacity=64 policy=drop_by_level drop_level=debug\n"
+         "level value=info\n"
+         "link file path=" + first + " append=false buffer=4096\n");
+      LogConfig config = LogConfig::parse( in);
+      CPPUNIT_ASSERT( config.asynchronous());
+      {
+         Log log;
+         config.apply( log);
+         log.message(LL_info) << "kept";
+         log.message(LL_debug) << "filtered";
+      }
+      CPPUNIT_ASSERT_EQUAL( std::string("kept\n"), contents( first));
+   }
+
+   //! errors name the line, a chain that can not be built leaves the Log alone
+   void errors()
+   {
+      CPPUNIT_ASSERT( error( "link cout\nlink nosuch\n").find( "line 2: unknown link type nosuch") != std::string::npos);
+      CPPUNIT_ASSERT( error( "level value=loud").find( "line 1:") != std::string::npos);
+      CPPUNIT_ASSERT( error( "link cout path=x").find( "cout has no option path") != std::string::npos);
+      CPPUNIT_ASSERT( error( "link ratelimit rate=10 burst=-1").find( "burst") != std::string::npos);
+      CPPUNIT_ASSERT( error( "async capacity=8 policy=never").find( "never") != std::string::npos);
+      CPPUNIT_ASSERT( error( "\nlink file append=true").find( "line 2: missing option path") != std::string::npos);
+      CPPUNIT_ASSERT_EQUAL( std::string(), error( "link tagging\nlink cerr level=error propagate=false"));
+
+      bufferingChainLink* buffer = new bufferingChainLink( LL_debug);
+      Log log;
+      log.setOutputChain( buffer);
+      std::istringstream in( "link cout\nlink file path=/nonexistent/dir/x.log\n");
+      CPPUNIT_ASSERT_THROW( LogConfig::parse( in).apply( log), std::invalid_argument);
+      log.message(LL_info) << "still there";
+      CPPUNIT_ASSERT_EQUAL( std::size_t(1), buffer->getMessages().size());
+   }
+
+   //! level lines replace all levels set before
+   void levels()
+   {
+      Log log;
+      log.setLevel( "db", LL_debug);
+      std::istringstream in(
+         "level value=warning\n"
+         "level name=net value=debug\n"
+         "link file path=" + first + "\n");
+      LogConfig::parse( in).apply( log);
+      CPPUNIT_ASSERT( !log.enabled( LL_info));
+      CPPUNIT_ASSERT( log.child( "net.http").enabled( LL_debug));
+      CPPUNIT_ASSERT( !log.child( "db").enabled( LL_info));
+   }
+
+   //! a changed file is installed while other threads log, without losing messages
+   void watched()
+   {
+      const int threads = 4;
+      const int messages = 2000;
+      write( filename, "link file path=" + first + "\n");
+      {
+         Log log;
+         LogConfigWatcher watcher( log, filename);
+         CPPUNIT_ASSERT_EQUAL( std::size_t(1), watcher.reloads());
+
+         std::vector<std::thread> writers;
+         for( int t = 0; t < threads; ++t) {
+            writers.emplace_back( [&log, t] {
+               for( int i = 0; i < messages; ++i)
+                  log.message(LL_info) << "thread " << t << " message " << i;
+            });
+         }
+         write( filename, "link file path=" + second + "\n");
+         CPPUNIT_ASSERT( waitFor( watcher, 2));
+         for( auto& writer : writers)
+            writer.join();
+         log.message(LL_notice) << "after";
+
+         // a broken file keeps the current configuration
+         write( filename, "link nosuch\n");
+         for( int i = 0; i < 1000 && contents( second).find( "not applied") == std::string::npos; ++i)
+            std::this_thread::sleep_for( std::chrono::milliseconds(2));
+         CPPUNIT_ASSERT_EQUAL( std::size_t(2), watcher.reloads());
+         log.message(LL_error) << "still second";
+      }
+
+      std::string last = contents( second);
+      CPPUNIT_ASSERT( last.find( "after\n") != std::string::npos);
+      CPPUNIT_ASSERT( last.find( "not applied: log config line 1: unknown link type nosuch") != std::string::npos);
+      CPPUNIT_ASSERT( last.find( "still second\n") != std::string::npos);
+      // the messages of the writers, "after", the error and "still second"
+      CPPUNIT_ASSERT_EQUAL( std::size_t(threads * messages + 3), lines( first) + lines( second));
+   }
+
+   //! binary and ring files written before a reload are continued
+   void continued()
+   {
+      write( filename, "link binary path=" + binary + "\nlink ring path=" + ring + " capacity=4096\n");
+      {
+         Log log;
+         LogConfigWatcher watcher( log, filename);
+         log.message(LL_info) << "before";
+         LOG_DEFERRED( log, LL_info, "deferred {}", 1);
+
+         write( filename, "level value=info\nlink binary path=" + binary + "\nlink ring path=" + ring + " capacity=4096\n");
+         CPPUNIT_ASSERT( waitFor( watcher, 2));
+         log.message(LL_info) << "after";
+         LOG_DEFERRED( log, LL_info, "deferred {}", 2);
+
+         // the mapped ring file can not be resized
+         write( filename, "link ring path=" + ring + " capacity=8192\n");
+         for( int i = 0; i < 1000 && binaryFileChainLink::readMessages( binary).size() < 5; ++i)
+            std::this_thread::sleep_for( std::chrono::milliseconds(2));
+         CPPUNIT_ASSERT_EQUAL( std::size_t(2), watcher.reloads());
+      }
+
+      auto messages = binaryFileChainLink::readMessages( binary);
+      CPPUNIT_ASSERT_EQUAL( std::size_t(5), messages.size());
+      CPPUNIT_ASSERT_EQUAL( std::string("before"), messages[0].second);
+      CPPUNIT_ASSERT_EQUAL( std::string("deferred 1"), messages[1].second);
+      CPPUNIT_ASSERT_EQUAL( std::string("after"), messages[2].second);
+      CPPUNIT_ASSERT_EQUAL( std::string("deferred 2"), messages[3].second);
+      CPPUNIT_ASSERT( messages[4].second.find( "line 1: ring file " + ring + " can not change its capacity") != std::string::npos);
+
+      messages = ringFileChainLink::readMessages( ring);
+      CPPUNIT_ASSERT_EQUAL( std::size_t(5), messages.size());
+      CPPUNIT_ASSERT_EQUAL( std::string("before"), messages[0].second);
+      CPPUNIT_ASSERT_EQUAL( std::string("deferred 2"), messages[3].second);
+   }
+
+   //! a reload appends to the file in use even with append=false
+   void notTruncated()
+   {
+      std::ofstream( first.c_str()) << "old run\n";
+      write( filename, "link file path=" + first + " append=false\n");
+      {
+         Log log;
+         LogConfigWatcher watcher( log, filename);
+         log.message(LL_info) << "before";
+         write( filename, "level value=info\nlink file path=" + first + " append=false\n");
+         CPPUNIT_ASSERT( waitFor( watcher, 2));
+         log.message(LL_info) << "after";
+      }
+      CPPUNIT_ASSERT_EQUAL( std::string("before\nafter\n"), contents( first));
+   }
+
+   void sighup()
+   {
+      write( filename, "link file path=" + first + "\n");
+      Log log;
+      LogConfigWatcher watcher( log, filename, true);
+      CPPUNIT_ASSERT_THROW( LogConfigWatcher( log, filename, true), std::invalid_argument);
+      std::raise( SIGHUP);
+      CPPUNIT_ASSERT( waitFor( watcher, 2));
+      watcher.reload();
+      CPPUNIT_ASSERT( waitFor( watcher, 3));
+   }
+};
+
+const std::string config_test::filename = "config_test.conf";
+const std::string config_test::first = "config_test_1.log";
+const std::string config_test::second = "config_test_2.log";
+const std::string config_test::binary = "config_test.bin";
+const std::string config_test::ring = "config_test.ring";
+
+CPPUNIT_TEST_SUITE_REGISTRATION(config_test);
@@ -0,0 +1,133 @@
+#include <cppunit/extensions/HelperMacros.h>
+#include "../Log.h"
+
+#include <string>
+#include <thread>
+
+namespace {
+   //! remembers the fields of the last message as "key=value" pairs
+   class fieldsChainLink : public outputChain {
+   public:
+      fieldsChainLink( outputChain* nextLink = 0)
+      : outputChain( LL_debug, true, nextLink) {}
+
+      std::string fields;
+
+   protected:
+      void real_log( LogLevel /* ll */, const std::string& /* str */) {}
+
+      void real_logRecord( const LogRecord& rec) {
+         fields.clear();
+         const char* args = rec.fields().data();
+         const char* end = args + rec.fields().size();
+         LogArguments::Argument key, value;
+         while( LogArguments::decode( args, end, key) && LogArguments::decode( args, end, value)) {
+            MessageBuffer out;
+            LogArguments::append( key, out);
+            out.append( "=", 1);
+            LogArguments::append( value, out);
+            out.append( ";", 1);
+            fields += out.str();
+         }
+      }
+   };
+} // namespace
+
+class context_test : public CppUnit::TestFixture
+{
+   CPPUNIT_TEST_SUITE(context_test);
+   CPPUNIT_TEST(prefix);
+   CPPUNIT_TEST(fields);
+   CPPUNIT_TEST(deferred);
+   CPPUNIT_TEST(captured);
+   CPPUNIT_TEST_SUITE_END();
+
+public:
+   void prefix()
+   {
+      bufferingChainLink* buffer = new bufferingChainLink( LL_info);
+      Log log;
+      log.setOutputChain( buffer);
+      {
+         LogScope tenant( "[acme] ");
+         log.message(LL_info) << "outer";
+         {
+            LogScope request( "request", 42);
+            log.message(LL_info) << "inner";
+            // nothing is logged for an empty message
+            log.message(LL_info);
+         }
+         log.message(LL_info) << "outer again";
+      }
+      log.message(LL_info) << "none";
+
+      auto messages = buffer->getMessages();
+      CPPUNIT_ASSERT_EQUAL( std::size_t(4), messages.size());
+      CPPUNIT_ASSERT_EQUAL( std::string("[acme] outer"), messages[0].second);
+      CPPUNIT_ASSERT_EQUAL( std::string("[acme] request=42 inner"), messages[1].second);
+      CPPUNIT_ASSERT_EQUAL( std::string("[acme] outer again"), messages[2].second);
+      CPPUNIT_ASSERT_EQUAL( std::string("none"), messages[3].second);
+      CPPUNIT_ASSERT( !LogContext::current());
+   }
+
+   //! key/value scopes come before the fields of the message
+   void fields()
+   {
+      fieldsChainLink* link = new fieldsChainLink;
+      Log log;
+      log.setOutputChain( link);
+      LogScope tenant( "tenant", "acme");
+      LogScope request( "request", 42);
+      log.message(LL_info).kv( "latency_us", 17) << "done";
+      CPPUNIT_ASSERT_EQUAL( std::string("tenant=acme;request=42;latency_us=17;"), link->fields);
+   }
+
+   //! deferred messages are formatted with the context of the logging thread
+   void deferred()
+   {
+      bufferingChainLink* buffer = new bufferingChainLink( LL_info);
+      fieldsChainLink* link = new fieldsChainLink( buffer);
+      Log log;
+      log.setOutputChain( link);
+      {
+         LogScope request( "request", 42);
+         LOG_DEFERRED( log, LL_info, "took {} ms", 17);
+         CPPUNIT_ASSERT_EQUAL( std::string("request=42;"), link->fields);
+
+         log.startAsync( 16);
+         LOG_DEFERRED( log, LL_info, "queued {}", 1);
+      }
+      log.flush();
+
+      auto messages = buffer->getMessages();
+      CPPUNIT_ASSERT_EQUAL( std::size_t(2), messages.size());
+      CPPUNIT_ASSERT_EQUAL( std::string("request=42 took 17 ms"), messages[0].second);
+      CPPUNIT_ASSERT_EQUAL( std::string("request=42 queued 1"), messages[1].second);
+      CPPUNIT_ASSERT_EQUAL( std::string("request=42;"), link->fields);
+   }
+
+   //! work handed to another thread keeps the context it was created in
+   void captured()
+   {
+      bufferingChainLink* buffer = new bufferingChainLink( LL_info);
+      Log log;
+      log.setOutputChain( buffer);
+      LogContext::Ptr context;
+      {
+         LogScope request( "request", 7);
+         context = LogContext::capture();
+      }
+      std::thread worker( [&log, context] {
+         LogScope scope( context);
+         log.message(LL_info) << "on worker";
+      });
+      worker.join();
+      log.message(LL_info) << "after";
+
+      auto messages = buffer->getMessages();
+      CPPUNIT_ASSERT_EQUAL( std::string("request=7 on worker"), messages[0].second);
+      CPPUNIT_ASSERT_EQUAL( std::string("after"), messages[1].second);
+   }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(context_test);
@@ -0,0 +1,141 @@
+#include <cppunit/extensions/HelperMacros.h>
+#include "../Log.h"
+
+#include <cstdio>
+#include <string>
+
+namespace {
+   //! remembers whether the messages it got were still deferred
+   class recordChainLink : public outputChain {
+   public:
+      recordChainLink()
+      : outputChain( LL_debug, true, 0), deferred(0) {}
+
+      bufferingChainLink::LogBuffer messages;
+      int deferred;
+
+   protected:
+      void real_log( LogLevel ll, const std::string& str) {
+         messages.push_back( std::make_pair( ll, str));
+      }
+
+      void real_logRecord( const LogRecord& rec) {
+         if( rec.deferred())
+            ++deferred;
+         outputChain::real_logRecord( rec);
+      }
+   };
+} // namespace
+
+class deferred_test : public CppUnit::TestFixture
+{
+   CPPUNIT_TEST_SUITE(deferred_test);
+   CPPUNIT_TEST(formatting);
+   CPPUNIT_TEST(sameAsStream);
+   CPPUNIT_TEST(argumentCount);
+   CPPUNIT_TEST(disabled);
+   CPPUNIT_TEST(async);
+   CPPUNIT_TEST(binaryFile);
+   CPPUNIT_TEST_SUITE_END();
+
+private:
+   Log* log;
+   recordChainLink* link;
+   static const char* filename;
+
+   std::string last() {
+      return link->messages.back().second;
+   }
+
+public:
+   void setUp()
+   {
+      log = new Log;
+      link = new recordChainLink;
+      log->setOutputChain( link);
+   }
+
+   void tearDown()
+   {
+      delete log;
+      std::remove( filename);
+   }
+
+   void formatting()
+   {
+      std::string name( "world");
+      LOG_DEFERRED( *log, LL_info, "hello {}, {} {} {} {} {}", name, 'x', true, -3, 42u, "!");
+      CPPUNIT_ASSERT_EQUAL( std::string("hello world, x true -3 42 !"), last());
+      CPPUNIT_ASSERT( link->messages.back().first == LL_info);
+      CPPUNIT_ASSERT_EQUAL( 1, link->deferred);
+
+      LOG_DEFERRED( *log, LL_info, "no arguments");
+      CPPUNIT_ASSERT_EQUAL( std::string("no arguments"), last());
+   }
+
+   //! deferred messages look like those written with operator<<
+   void sameAsStream()
+   {
+      short s = -7;
+      unsigned long long big = 18446744073709551615ull;
+      LOG_DEFERRED( *log, LL_info, "{} {} {} {} {}", 0.1, 1.5f, s, big, static_cast<const void*>(0));
+      log->message(LL_info) << 0.1 << ' ' << 1.5f << ' ' << s << ' ' << big << ' ' << static_cast<const void*>(0);
+      CPPUNIT_ASSERT_EQUAL( link->messages[1].second, link->messages[0].second);
+   }
+
+   void argumentCount()
+   {
+      LOG_DEFERRED( *log, LL_info, "{} and {}", 1);
+      CPPUNIT_ASSERT_EQUAL( std::string("1 and {}"), last());
+      LOG_DEFERRED( *log, LL_info, "{}", 1, 2, "three");
+      CPPUNIT_ASSERT_EQUAL( std::string("1 2 three"), last());
+   }
+
+   void disabled()
+   {
+      link->setLogLevel( LL_info);
+      int evaluated = 0;
+      LOG_DEFERRED( *log, LL_debug, "{}", ++evaluated);
+      CPPUNIT_ASSERT_EQUAL( 0, evaluated);
+      CPPUNIT_ASSERT( link->messages.empty());
+   }
+
+   //! the background thread gets the encoded arguments
+   void async()
+   {
+      log->startAsync( 16);
+      for( int i = 0; i < 100; ++i)
+         LOG_DEFERRED( *log, LL_info, "message {}", i);
+      log->flush();
+      CPPUNIT_ASSERT_EQUAL( std::size_t(100), link->messages.size());
+      CPPUNIT_ASSERT_EQUAL( 100, link->deferred);
+      CPPUNIT_ASSERT_EQUAL( std::string("message 99"), last());
+   }
+
+   void binaryFile()
+   {
+      {
+         Log binary;
+         binary.setOutputChain( new binaryFileChainLink( filename, LL_debug));
+         for( int i = 0; i < 3; ++i) {
+            LOG_DEFERRED( binary, LL_info, "iteration {} of {}", i, 3);
+            LOG_DEFERRED( binary, LL_notice, "ratio {}", 0.5 * i);
+         }
+         binary.message(LL_error) << "formatted " << 1;
+      }
+
+      auto messages = binaryFileChainLink::readMessages( filename);
+      CPPUNIT_ASSERT_EQUAL( std::size_t(7), messages.size());
+      CPPUNIT_ASSERT_EQUAL( std::string("iteration 0 of 3"), messages[0].second);
+      CPPUNIT_ASSERT( messages[0].first == LL_info);
+      CPPUNIT_ASSERT_EQUAL( std::string("ratio 0.5"), messages[3].second);
+      CPPUNIT_ASSERT( messages[3].first == LL_notice);
+      CPPUNIT_ASSERT_EQUAL( std::string("iteration 2 of 3"), messages[4].second);
+      CPPUNIT_ASSERT_EQUAL( std::string("formatted 1"), messages[6].second);
+      CPPUNIT_ASSERT( messages[6].first == LL_error);
+   }
+};
+
+const char* deferred_test::filename = "deferred_test.log";
+
+CPPUNIT_TEST_SUITE_REGISTRATION(deferred_test);
@@ -0,0 +1,112 @@
+#include <cppunit/extensions/HelperMacros.h>
+#include "../Log.h"
+
+#include <string>
+
+namespace {
+   //! raises the log level of another link when it writes the first message
+   class levelChangingChainLink : public outputChain {
+   public:
+      levelChangingChainLink( outputChain* target, outputChain* nextLink)
+      : outputChain( LL_debug, true, nextLink)
+      , target( target) {}
+
+   protected:
+      void real_log( LogLevel /* ll */, const std::string& /* str */) {
+         if( target) {
+            target->setLogLevel( LL_debug);
+            target = 0;
+         }
+      }
+
+   private:
+      outputChain* target;
+   };
+} // namespace
+
+class dispatch_test : public CppUnit::TestFixture
+{
+   CPPUNIT_TEST_SUITE(dispatch_test);
+   CPPUNIT_TEST(propagation);
+   CPPUNIT_TEST(levelChange);
+   CPPUNIT_TEST(levelChangeWhileLogging);
+   CPPUNIT_TEST(behindForwardingLink);
+   CPPUNIT_TEST_SUITE_END();
+
+public:
+   void propagation()
+   {
+      bufferingChainLink* last = new bufferingChainLink( LL_debug);
+      bufferingChainLink* middle = new bufferingChainLink( LL_info, true, last);
+      bufferingChainLink* first = new bufferingChainLink( LL_warning, false, middle);
+      Log log;
+      log.setOutputChain( first);
+      log.message(LL_error) << "error";
+      log.message(LL_info) << "info";
+      log.message(LL_debug) << "debug";
+
+      CPPUNIT_ASSERT_EQUAL( std::size_t(1), first->getMessages().size());
+      CPPUNIT_ASSERT_EQUAL( std::size_t(1), middle->getMessages().size());
+      CPPUNIT_ASSERT_EQUAL( std::string("info"), middle->getMessages()[0].second);
+      CPPUNIT_ASSERT_EQUAL( std::size_t(2), last->getMessages().size());
+
+      // links a message passes without writing it still count it
+      LogMetrics metrics = log.metrics();
+      CPPUNIT_ASSERT_EQUAL( 1ull, metrics.links[0].filtered[LL_info]);
+      CPPUNIT_ASSERT_EQUAL( 1ull, metrics.links[0].filtered[LL_debug]);
+      CPPUNIT_ASSERT_EQUAL( 1ull, metrics.links[1].filtered[LL_debug]);
+      CPPUNIT_ASSERT_EQUAL( 0ull, metrics.links[1].filtered[LL_error]);
+   }
+
+   void levelChange()
+   {
+      bufferingChainLink* last = new bufferingChainLink( LL_warning);
+      Log log;
+      log.setOutputChain( new bufferingChainLink( LL_error, true, last));
+      log.message(LL_info) << "dropped";
+      CPPUNIT_ASSERT( last->getMessages().empty());
+
+      last->setLogLevel( LL_info);
+      log.message(LL_info) << "written";
+      CPPUNIT_ASSERT_EQUAL( std::size_t(1), last->getMessages().size());
+
+      last->setLogLevel( LL_warning);
+      log.message(LL_info) << "dropped again";
+      CPPUNIT_ASSERT_EQUAL( std::size_t(1), last->getMessages().size());
+   }
+
+   //! the replaced table is kept until the thread stopped using it
+   void levelChangeWhileLogging()
+   {
+      bufferingChainLink* last = new bufferingChainLink( LL_info);
+      Log log;
+      log.setOutputChain( new levelChangingChainLink( last, last));
+      log.message(LL_info) << "first";
+      log.message(LL_debug) << "second";
+
+      CPPUNIT_ASSERT_EQUAL( std::size_t(2), last->getMessages().size());
+      CPPUNIT_ASSERT_EQUAL( std::string("second"), last->getMessages()[1].second);
+   }
+
+   void behindForwardingLink()
+   {
+      bufferingChainLink* last = new bufferingChainLink( LL_debug);
+      bufferingChainLink* first = new bufferingChainLink( LL_info, false, last);
+      Log log;
+      log.setOutputChain( new taggingChainLink( first));
+      log.message(LL_info) << "info";
+      log.message(LL_debug) << "debug";
+      CPPUNIT_ASSERT_EQUAL( std::size_t(1), first->getMessages().size());
+      CPPUNIT_ASSERT_EQUAL( std::size_t(1), last->getMessages().size());
+      CPPUNIT_ASSERT( last->getMessages()[0].second.find( "debug") != std::string::npos);
+
+      last->setLogLevel( LL_info);
+      CPPUNIT_ASSERT( !log.enabled( LL_debug));
+      first->setLogLevel( LL_error);
+      log.message(LL_info) << "info";
+      CPPUNIT_ASSERT_EQUAL( std::size_t(1), first->getMessages().size());
+      CPPUNIT_ASSERT_EQUAL( std::size_t(2), last->getMessages().size());
+   }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(dispatch_test);
@@ -0,0 +1,89 @@
+#include <cppunit/extensions/HelperMacros.h>
+#include "../Log.h"
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+
+static std::string contents( const std::string& filename) {
+   std::ifstream in( filename.c_str());
+   std::ostringstream s;
+   s << in.rdbuf();
+   return s.str();
+}
+
+class file_test : public CppUnit::TestFixture
+{
+   CPPUNIT_TEST_SUITE(file_test);
+   CPPUNIT_TEST(unbuffered);
+   CPPUNIT_TEST(buffered);
+   CPPUNIT_TEST(bufferFull);
+   CPPUNIT_TEST(interval);
+   CPPUNIT_TEST_SUITE_END();
+
+private:
+   Log* log;
+   fileChainLink* file;
+   static const char* filename;
+
+public:
+   void setUp()
+   {
+      log = new Log;
+      file = new fileChainLink( filename, true, LL_debug);
+      log->setOutputChain( file);
+   }
+
+   void tearDown()
+   {
+      delete log;
+      std::remove( filename);
+   }
+
+   void unbuffered()
+   {
+      log->message(LL_info) << "first";
+      log->message(LL_debug) << "second";
+      CPPUNIT_ASSERT_EQUAL( std::string("first\nsecond\n"), contents( filename));
+   }
+
+   void buffered()
+   {
+      file->setBuffering( 1024, std::chrono::milliseconds(0), LL_error);
+      log->message(LL_info) << "first";
+      log->message(LL_debug) << "second";
+      CPPUNIT_ASSERT_EQUAL( std::string(), contents( filename));
+
+      log->message(LL_error) << "error";
+      CPPUNIT_ASSERT_EQUAL( std::string("first\nsecond\nerror\n"), contents( filename));
+
+      log->message(LL_info) << "third";
+      log->flush();
+      CPPUNIT_ASSERT_EQUAL( std::string("first\nsecond\nerror\nthird\n"), contents( filename));
+   }
+
+   void bufferFull()
+   {
+      file->setBuffering( 16, std::chrono::milliseconds(0), LL_emerg);
+      log->message(LL_info) << "0123456789";
+      CPPUNIT_ASSERT_EQUAL( std::string(), contents( filename));
+      log->message(LL_info) << "abcdefghij";
+      CPPUNIT_ASSERT_EQUAL( std::string("0123456789\nabcdefghij\n"), contents( filename));
+   }
+
+   void interval()
+   {
+      file->setBuffering( 1024, std::chrono::milliseconds(10), LL_emerg);
+      log->message(LL_info) << "first";
+      for( int i = 0; i < 500 && contents( filename).empty(); ++i)
+         std::this_thread::sleep_for( std::chrono::milliseconds(2));
+      CPPUNIT_ASSERT_EQUAL( std::string("first\n"), contents( filename));
+   }
+};
+
+const char* file_test::filename = "file_test.log";
+
+CPPUNIT_TEST_SUITE_REGISTRATION(file_test);
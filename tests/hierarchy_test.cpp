@@ -0,0 +1,131 @@
+#include <cppunit/extensions/HelperMacros.h>
+#include "../Log.h"
+
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+class hierarchy_test : public CppUnit::TestFixture
+{
+   CPPUNIT_TEST_SUITE(hierarchy_test);
+   CPPUNIT_TEST(sharedChain);
+   CPPUNIT_TEST(inherited);
+   CPPUNIT_TEST(byPrefix);
+   CPPUNIT_TEST(chainLevel);
+   CPPUNIT_TEST(replacedLevels);
+   CPPUNIT_TEST_SUITE_END();
+
+private:
+   bufferingChainLink* buffer;
+   Log* log;
+
+public:
+   void setUp()
+   {
+      log = new Log;
+      buffer = new bufferingChainLink( LL_debug);
+      log->setOutputChain( buffer);
+   }
+
+   void tearDown()
+   {
+      delete log;
+   }
+
+   void sharedChain()
+   {
+      Log& http = log->child( "net.http");
+      CPPUNIT_ASSERT_EQUAL( std::string("net.http"), http.name());
+      CPPUNIT_ASSERT( &http == &log->child( "net").child( "http"));
+      http.message(LL_info) << "from http";
+      LOG_DEFERRED( http, LL_info, "deferred {}", 1);
+      log->message(LL_info) << "from root";
+
+      auto messages = buffer->getMessages();
+      CPPUNIT_ASSERT_EQUAL( std::size_t(3), messages.size());
+      CPPUNIT_ASSERT_EQUAL( std::string("from http"), messages[0].second);
+      CPPUNIT_ASSERT_EQUAL( std::string("deferred 1"), messages[1].second);
+      CPPUNIT_ASSERT_EQUAL( 3ull, log->metrics().logged[LL_info]);
+      CPPUNIT_ASSERT_THROW( http.setOutputChain( 0), std::invalid_argument);
+      CPPUNIT_ASSERT_THROW( log->child( ""), std::invalid_argument);
+   }
+
+   //! children without a level of their own take the one of their closest parent
+   void inherited()
+   {
+      Log& net = log->child( "net");
+      Log& http = log->child( "net.http");
+      Log& db = log->child( "db.pool");
+      log->setLevel( "", LL_warning);
+      CPPUNIT_ASSERT( !http.enabled( LL_info));
+
+      log->setLevel( "net", LL_debug);
+      CPPUNIT_ASSERT( net.enabled( LL_debug));
+      CPPUNIT_ASSERT( http.enabled( LL_debug));
+      CPPUNIT_ASSERT( !db.enabled( LL_info));
+      CPPUNIT_ASSERT( !log->enabled( LL_info));
+
+      net.setLevel( "http", LL_error);
+      CPPUNIT_ASSERT( !http.enabled( LL_warning));
+      CPPUNIT_ASSERT( net.enabled( LL_debug));
+      // created after the level was set
+      CPPUNIT_ASSERT( log->child( "net.http.client").enabled( LL_error));
+      CPPUNIT_ASSERT( !log->child( "net.http.client").enabled( LL_warning));
+
+      http.resetLevel( "");
+      CPPUNIT_ASSERT( http.enabled( LL_debug));
+      http.message(LL_debug) << "written";
+      db.message(LL_debug) << "not written";
+      CPPUNIT_ASSERT_EQUAL( std::size_t(1), buffer->getMessages().size());
+   }
+
+   //! setting a level replaces the levels set under the prefix
+   void byPrefix()
+   {
+      Log& http = log->child( "net.http");
+      Log& network = log->child( "network");
+      log->setLevel( "net.http", LL_error);
+      log->setLevel( "network", LL_error);
+      log->setLevel( "net", LL_info);
+      CPPUNIT_ASSERT( http.enabled( LL_info));
+      CPPUNIT_ASSERT( !network.enabled( LL_info));
+
+      log->resetLevel( "");
+      CPPUNIT_ASSERT( network.enabled( LL_debug));
+   }
+
+   //! children never enable more than the output chain writes
+   void chainLevel()
+   {
+      Log& http = log->child( "net.http");
+      log->setLevel( "net", LL_debug);
+      buffer->setLogLevel( LL_info);
+      CPPUNIT_ASSERT( !http.enabled( LL_debug));
+      CPPUNIT_ASSERT( http.enabled( LL_info));
+      log->setOutputChain( 0);
+      CPPUNIT_ASSERT( !http.enabled( LL_emerg));
+   }
+
+   //! levels installed with a chain replace all levels, applied in order
+   void replacedLevels()
+   {
+      Log& http = log->child( "net.http");
+      Log& db = log->child( "db");
+      log->setLevel( "db", LL_debug);
+      std::vector<std::pair<std::string, LogLevel>> levels;
+      levels.push_back( std::make_pair( "", LL_warning));
+      levels.push_back( std::make_pair( "net.http", LL_debug));
+      levels.push_back( std::make_pair( "net", LL_info));
+      buffer = new bufferingChainLink( LL_debug);
+      log->setOutputChain( buffer, levels);
+
+      CPPUNIT_ASSERT( !log->enabled( LL_notice));
+      CPPUNIT_ASSERT( !db.enabled( LL_notice));
+      // "net" came after "net.http" and replaced it
+      CPPUNIT_ASSERT( http.enabled( LL_info));
+      CPPUNIT_ASSERT( !http.enabled( LL_debug));
+   }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(hierarchy_test);
@@ -0,0 +1,126 @@
+#include <cppunit/extensions/HelperMacros.h>
+#include "../Log.h"
+
+#include <cstdio>
+#include <fstream>
+#include <limits>
+#include <sstream>
+#include <string>
+
+namespace {
+   std::string contents( const std::string& filename) {
+      std::ifstream in( filename.c_str());
+      std::ostringstream s;
+      s << in.rdbuf();
+      return s.str();
+   }
+
+   //! remembers the text and the formatted fields of the last message
+   class fieldsChainLink : public outputChain {
+   public:
+      fieldsChainLink()
+      : outputChain( LL_debug, true, 0) {}
+
+      std::string text;
+      std::string fields;
+
+   protected:
+      void real_log( LogLevel /* ll */, const std::string& str) {
+         text = str;
+      }
+
+      void real_logRecord( const LogRecord& rec) {
+         MessageBuffer out;
+         const char* p = rec.fields().data();
+         const char* end = p + rec.fields().size();
+         LogArguments::Argument arg;
+         while( LogArguments::decode( p, end, arg)) {
+            LogArguments::append( arg, out);
+            out.append( ";", 1);
+         }
+         fields = out.str();
+         outputChain::real_logRecord( rec);
+      }
+   };
+} // namespace
+
+class json_test : public CppUnit::TestFixture
+{
+   CPPUNIT_TEST_SUITE(json_test);
+   CPPUNIT_TEST(fieldsInChain);
+   CPPUNIT_TEST(fieldsAsync);
+   CPPUNIT_TEST(jsonLines);
+   CPPUNIT_TEST(escaping);
+   CPPUNIT_TEST_SUITE_END();
+
+private:
+   static const char* filename;
+
+public:
+   void tearDown()
+   {
+      std::remove( filename);
+   }
+
+   //! text links only see the message, fields survive tagging
+   void fieldsInChain()
+   {
+      Log log;
+      auto fields = new fieldsChainLink;
+      auto buffer = new bufferingChainLink( LL_debug, true, fields);
+      log.setOutputChain( new taggingChainLink( buffer));
+
+      log.message(LL_info).kv("user", 42).kv("name", std::string("bob")) << "request done";
+      CPPUNIT_ASSERT_EQUAL( std::string("request done"), buffer->getMessages().at(0).second.substr( 8));
+      CPPUNIT_ASSERT_EQUAL( std::string("user;42;name;bob;"), fields->fields);
+      CPPUNIT_ASSERT_EQUAL( buffer->getMessages().at(0).second, fields->text);
+
+      // a message with fields only is logged too
+      log.message(LL_info).kv("alive", true);
+      CPPUNIT_ASSERT_EQUAL( std::string("alive;true;"), fields->fields);
+   }
+
+   void fieldsAsync()
+   {
+      Log log;
+      auto fields = new fieldsChainLink;
+      log.setOutputChain( fields);
+      log.startAsync( 4);
+      for( int i = 0; i < 10; ++i)
+         log.message(LL_info).kv("i", i) << "message";
+      log.flush();
+      CPPUNIT_ASSERT_EQUAL( std::string("i;9;"), fields->fields);
+      CPPUNIT_ASSERT_EQUAL( std::string("message"), fields->text);
+   }
+
+   void jsonLines()
+   {
+      {
+         Log log;
+         log.setOutputChain( new jsonFileChainLink( filename, true, LL_debug));
+         log.message(LL_info).kv("user", 42).kv("latency_us", 17.5).kv("ok", false) << "request done";
+         log.message(LL_error).kv("delta", -3).kv("grade", 'A').kv("none", static_cast<const void*>(0))
+            .kv("inf", std::numeric_limits<double>::infinity()) << "second";
+      }
+      CPPUNIT_ASSERT_EQUAL( std::string(
+         "{\"level\":\"info\",\"message\":\"request done\",\"user\":42,\"latency_us\":17.5,\"ok\":false}\n"
+         "{\"level\":\"error\",\"message\":\"second\",\"delta\":-3,\"grade\":\"A\",\"none\":\"0\",\"inf\":null}\n"),
+         contents( filename));
+   }
+
+   void escaping()
+   {
+      {
+         Log log;
+         log.setOutputChain( new jsonFileChainLink( filename, true, LL_debug));
+         log.message(LL_info).kv("path", "C:\\tmp") << "say \"hi\"\n\tnow" << '\x01' << "\xc3\xa4";
+      }
+      CPPUNIT_ASSERT_EQUAL( std::string(
+         "{\"level\":\"info\",\"message\":\"say \\\"hi\\\"\\n\\tnow\\u0001\xc3\xa4\",\"path\":\"C:\\\\tmp\"}\n"),
+         contents( filename));
+   }
+};
+
+const char* json_test::filename = "json_test.log";
+
+CPPUNIT_TEST_SUITE_REGISTRATION(json_test);
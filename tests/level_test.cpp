@@ -0,0 +1,106 @@
+#include <cppunit/extensions/HelperMacros.h>
+#include "../Log.h"
+
+#include <string>
+#include <ostream>
+#include <type_traits>
+
+static int formatted = 0;
+
+struct counted {
+};
+
+std::ostream& operator<<( std::ostream& out, const counted&);
+std::ostream& operator<<( std::ostream& out, const counted&) {
+   ++formatted;
+   return out << "counted";
+}
+
+static int evaluated = 0;
+
+static int evaluate();
+static int evaluate() {
+   return ++evaluated;
+}
+
+class level_test : public CppUnit::TestFixture
+{
+   CPPUNIT_TEST_SUITE(level_test);
+   CPPUNIT_TEST(disabled);
+   CPPUNIT_TEST(macro);
+   CPPUNIT_TEST(chainLevel);
+   CPPUNIT_TEST(compiledLevel);
+   CPPUNIT_TEST_SUITE_END();
+
+private:
+   bufferingChainLink* loggedMessages;
+   Log* log;
+
+public:
+   void setUp()
+   {
+      formatted = 0;
+      evaluated = 0;
+      log = new Log;
+      loggedMessages = new bufferingChainLink(LL_info);
+      log->setOutputChain(loggedMessages);
+   }
+
+   void tearDown()
+   {
+      delete log;
+   }
+
+   void disabled()
+   {
+      counted c;
+      log->message(LL_debug) << c << "x";
+      log->message(LL_info) << c;
+
+      CPPUNIT_ASSERT_MESSAGE( "formatted", formatted == 1);
+      CPPUNIT_ASSERT_MESSAGE( "number", loggedMessages->getMessages().size() == 1);
+   }
+
+   void macro()
+   {
+      LOG_MESSAGE(*log, LL_debug) << evaluate();
+      LOG_MESSAGE(*log, LL_info) << evaluate();
+
+      CPPUNIT_ASSERT_MESSAGE( "evaluated", evaluated == 1);
+      CPPUNIT_ASSERT_MESSAGE( "number", loggedMessages->getMessages().size() == 1);
+      CPPUNIT_ASSERT_MESSAGE( "message", loggedMessages->getMessages().at(0).second == "1");
+   }
+
+   void chainLevel()
+   {
+      CPPUNIT_ASSERT( log->enabled(LL_info));
+      CPPUNIT_ASSERT( !log->enabled(LL_debug));
+
+      loggedMessages->setLogLevel(LL_debug);
+      CPPUNIT_ASSERT( log->enabled(LL_debug));
+
+      // the tagging link does not write anything itself, the cerr link
+      // only gets messages not taken by the non propagating buffer
+      auto buffer = new bufferingChainLink(LL_warning, false, new cerrChainLink(LL_error));
+      log->setOutputChain(new taggingChainLink(buffer));
+      CPPUNIT_ASSERT( log->enabled(LL_warning));
+      CPPUNIT_ASSERT( !log->enabled(LL_notice));
+
+      log->setOutputChain(0);
+      CPPUNIT_ASSERT( !log->enabled(LL_emerg));
+   }
+
+   void compiledLevel()
+   {
+      static_assert( std::is_same<StaticLogWriter<LL_debug, false>::type, NullLogWriter>::value, "removed level");
+      static_assert( std::is_same<StaticLogWriter<LL_emerg>::type, LogWriter>::value, "compiled level");
+
+      counted c;
+      log->message<LL_info>() << c;
+      log->message<LL_debug>() << c;
+      CPPUNIT_ASSERT_MESSAGE( "formatted", formatted == 1);
+      CPPUNIT_ASSERT_MESSAGE( "number", loggedMessages->getMessages().size() == 1);
+   }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(level_test);
@@ -0,0 +1,169 @@
+#include <cppunit/extensions/HelperMacros.h>
+#include "../Log.h"
+
+#include <chrono>
+#include <future>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+   //! the first message waits until release, after signalling entered
+   class stallingChainLink : public outputChain {
+   public:
+      stallingChainLink( std::shared_future<void> release)
+      : outputChain( LL_debug, true, 0)
+      , release( release)
+      , first( true) {}
+
+      std::promise<void> entered;
+
+   protected:
+      void real_log( LogLevel /* ll */, const std::string& /* str */) {
+         if( first) {
+            first = false;
+            entered.set_value();
+            release.wait();
+         }
+      }
+
+   private:
+      std::shared_future<void> release;
+      bool first;
+   };
+
+   //! takes at least a millisecond for every message
+   class slowChainLink : public outputChain {
+   public:
+      slowChainLink()
+      : outputChain( LL_debug, true, 0) {}
+
+   protected:
+      void real_log( LogLevel /* ll */, const std::string& /* str */) {
+         std::this_thread::sleep_for( std::chrono::milliseconds(1));
+      }
+   };
+} // namespace
+
+class metrics_test : public CppUnit::TestFixture
+{
+   CPPUNIT_TEST_SUITE(metrics_test);
+   CPPUNIT_TEST(counters);
+   CPPUNIT_TEST(threads);
+   CPPUNIT_TEST(queue);
+   CPPUNIT_TEST(timed);
+   CPPUNIT_TEST(report);
+   CPPUNIT_TEST_SUITE_END();
+
+public:
+   void counters()
+   {
+      Log log;
+      log.setOutputChain( new bufferingChainLink( LL_info, true, new bufferingChainLink( LL_error)));
+      for( int i = 0; i < 3; ++i)
+         log.message(LL_info) << "info " << i;
+      log.message(LL_error) << "error";
+      log.message(LL_debug) << "not counted";
+      LOG_DEFERRED( log, LL_info, "deferred {}", 3);
+
+      LogMetrics metrics = log.metrics();
+      CPPUNIT_ASSERT_EQUAL( 4ull, metrics.logged[LL_info]);
+      CPPUNIT_ASSERT_EQUAL( 1ull, metrics.logged[LL_error]);
+      CPPUNIT_ASSERT_EQUAL( 0ull, metrics.logged[LL_debug]);
+      CPPUNIT_ASSERT_EQUAL( 0ull, metrics.dropped[LL_info]);
+
+      CPPUNIT_ASSERT_EQUAL( std::size_t(2), metrics.links.size());
+      CPPUNIT_ASSERT_EQUAL( 4ull, metrics.links[0].written[LL_info]);
+      CPPUNIT_ASSERT_EQUAL( 1ull, metrics.links[0].written[LL_error]);
+      CPPUNIT_ASSERT_EQUAL( 33ull, metrics.links[0].bytes);
+      CPPUNIT_ASSERT_EQUAL( 4ull, metrics.links[1].filtered[LL_info]);
+      CPPUNIT_ASSERT_EQUAL( 1ull, metrics.links[1].written[LL_error]);
+      CPPUNIT_ASSERT_EQUAL( 5ull, metrics.links[1].bytes);
+      CPPUNIT_ASSERT( metrics.links[0].writeTime == std::chrono::nanoseconds(0));
+   }
+
+   //! more threads than counter slots, none of their messages is missed
+   void threads()
+   {
+      Log log;
+      log.setOutputChain( new bufferingChainLink( LL_debug));
+      std::vector<std::thread> threads;
+      for( int t = 0; t < 40; ++t) {
+         threads.emplace_back( [&log] {
+            for( int i = 0; i < 100; ++i)
+               log.message(LL_info) << "info";
+            log.message(LL_debug) << "debug";
+         });
+      }
+      for( auto& thread : threads)
+         thread.join();
+
+      LogMetrics metrics = log.metrics();
+      CPPUNIT_ASSERT_EQUAL( 4000ull, metrics.logged[LL_info]);
+      CPPUNIT_ASSERT_EQUAL( 40ull, metrics.logged[LL_debug]);
+   }
+
+   //! dropped messages and the most messages waiting in the asynchronous queue
+   void queue()
+   {
+      std::promise<void> release;
+      stallingChainLink* link = new stallingChainLink( release.get_future().share());
+      std::future<void> entered = link->entered.get_future();
+      Log log;
+      log.setOutputChain( link);
+      log.startAsync( 4, OP_dropNewest);
+
+      log.message(LL_info) << "stalls the background thread";
+      entered.wait();
+      for( int i = 0; i < 10; ++i)
+         log.message(LL_warning) << "message " << i;
+      release.set_value();
+      log.flush();
+
+      LogMetrics metrics = log.metrics();
+      CPPUNIT_ASSERT_EQUAL( 1ull, metrics.logged[LL_info]);
+      CPPUNIT_ASSERT_EQUAL( 4ull, metrics.logged[LL_warning]);
+      CPPUNIT_ASSERT_EQUAL( 6ull, metrics.dropped[LL_warning]);
+      CPPUNIT_ASSERT_EQUAL( std::size_t(4), metrics.queueHighWater);
+      CPPUNIT_ASSERT_EQUAL( 5ull, metrics.links[0].written[LL_info] + metrics.links[0].written[LL_warning]);
+
+      // kept after returning to synchronous logging
+      log.stopAsync();
+      CPPUNIT_ASSERT_EQUAL( std::size_t(4), log.metrics().queueHighWater);
+   }
+
+   void timed()
+   {
+      slowChainLink* link = new slowChainLink;
+      Log log;
+      log.setOutputChain( link);
+      link->setTimed( true);
+      for( int i = 0; i < 3; ++i)
+         log.message(LL_info) << "message " << i;
+
+      LinkMetrics metrics = link->metrics();
+      CPPUNIT_ASSERT( metrics.writeTime >= std::chrono::milliseconds(3));
+      CPPUNIT_ASSERT( metrics.lockWait < metrics.writeTime);
+   }
+
+   void report()
+   {
+      bufferingChainLink* buffer = new bufferingChainLink( LL_debug);
+      Log log;
+      log.setOutputChain( new metricsChainLink( std::chrono::milliseconds(10), LL_notice, buffer));
+      log.message(LL_info) << "first";
+      std::this_thread::sleep_for( std::chrono::milliseconds(20));
+      log.message(LL_info) << "second";
+      log.message(LL_info) << "third";
+
+      auto messages = buffer->getMessages();
+      CPPUNIT_ASSERT_EQUAL( std::size_t(4), messages.size());
+      CPPUNIT_ASSERT_EQUAL( std::string("metrics logged=2 dropped=0 queue_high_water=0"
+         " link1.written=1 link1.filtered=0 link1.bytes=0 link1.write_us=0 link1.lock_wait_us=0"
+         " link2.written=1 link2.filtered=0 link2.bytes=5 link2.write_us=0 link2.lock_wait_us=0"), messages[1].second);
+      CPPUNIT_ASSERT( messages[1].first == LL_notice);
+      CPPUNIT_ASSERT_EQUAL( std::string("second"), messages[2].second);
+   }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(metrics_test);
@@ -0,0 +1,139 @@
+#include <cppunit/extensions/HelperMacros.h>
+#include "../Log.h"
+
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+   //! keeps the messages where they outlive the link
+   class recordingChainLink : public outputChain {
+   public:
+      recordingChainLink( std::vector<std::string>& messages)
+      : outputChain( LL_debug, true, 0)
+      , messages( messages) {}
+
+   protected:
+      void real_log( LogLevel /* ll */, const std::string& str) {
+         messages.push_back( str);
+      }
+
+   private:
+      std::vector<std::string>& messages;
+   };
+} // namespace
+
+class ratelimit_test : public CppUnit::TestFixture
+{
+   CPPUNIT_TEST_SUITE(ratelimit_test);
+   CPPUNIT_TEST(burst);
+   CPPUNIT_TEST(refill);
+   CPPUNIT_TEST(periodicSummary);
+   CPPUNIT_TEST(callSites);
+   CPPUNIT_TEST(replaced);
+   CPPUNIT_TEST_SUITE_END();
+
+private:
+   Log* log;
+   bufferingChainLink* buffer;
+
+   void setUpLimit( double messagesPerSecond, unsigned burst, std::chrono::milliseconds summaryInterval) {
+      buffer = new bufferingChainLink( LL_debug);
+      log->setOutputChain( new rateLimitingChainLink( messagesPerSecond, burst, buffer, summaryInterval));
+   }
+
+public:
+   void setUp()
+   {
+      log = new Log;
+   }
+
+   void tearDown()
+   {
+      delete log;
+   }
+
+   //! burst messages pass, the rest is counted
+   void burst()
+   {
+      setUpLimit( 0.1, 3, std::chrono::milliseconds(100000));
+      for( int i = 0; i < 10; ++i) {
+         log->message(LL_info) << "flood";
+         log->message(LL_info) << "other " << i;
+      }
+      CPPUNIT_ASSERT_EQUAL( std::size_t(13), buffer->getMessages().size());
+
+      log->flush();
+      CPPUNIT_ASSERT_EQUAL( std::size_t(14), buffer->getMessages().size());
+      CPPUNIT_ASSERT_EQUAL( std::string("7 messages suppressed by rate limit"), buffer->getMessages().back().second);
+      CPPUNIT_ASSERT( buffer->getMessages().back().first == LL_notice);
+   }
+
+   //! the next message passing reports the suppressed ones
+   void refill()
+   {
+      setUpLimit( 50, 1, std::chrono::milliseconds(100000));
+      for( int i = 0; i < 5; ++i)
+         log->message(LL_warning) << "flood";
+      std::this_thread::sleep_for( std::chrono::milliseconds(30));
+      log->message(LL_warning) << "flood";
+
+      auto messages = buffer->getMessages();
+      CPPUNIT_ASSERT_EQUAL( std::size_t(3), messages.size());
+      CPPUNIT_ASSERT_EQUAL( std::string("message repeated 4 times: flood"), messages[1].second);
+      CPPUNIT_ASSERT( messages[1].first == LL_warning);
+      CPPUNIT_ASSERT_EQUAL( std::string("flood"), messages[2].second);
+   }
+
+   //! while suppressing, a summary is forwarded every interval
+   void periodicSummary()
+   {
+      setUpLimit( 0.1, 1, std::chrono::milliseconds(10));
+      log->message(LL_info) << "flood";
+      log->message(LL_info) << "flood";
+      log->message(LL_info) << "flood";
+      std::this_thread::sleep_for( std::chrono::milliseconds(20));
+      log->message(LL_info) << "flood";
+
+      auto messages = buffer->getMessages();
+      CPPUNIT_ASSERT_EQUAL( std::size_t(2), messages.size());
+      CPPUNIT_ASSERT_EQUAL( std::string("message repeated 3 times: flood"), messages[1].second);
+   }
+
+   //! deferred messages are limited per call site, whatever their arguments
+   void callSites()
+   {
+      setUpLimit( 0.1, 2, std::chrono::milliseconds(100000));
+      for( int i = 0; i < 10; ++i) {
+         LOG_DEFERRED( *log, LL_info, "first {}", i);
+         LOG_DEFERRED( *log, LL_info, "second {}", i);
+      }
+      auto messages = buffer->getMessages();
+      CPPUNIT_ASSERT_EQUAL( std::size_t(4), messages.size());
+      CPPUNIT_ASSERT_EQUAL( std::string("second 1"), messages[3].second);
+   }
+
+   //! summaries pending when the chain is replaced or the Log destroyed are written
+   void replaced()
+   {
+      std::vector<std::string> messages;
+      log->setOutputChain( new rateLimitingChainLink( 0.1, 1, new recordingChainLink( messages)));
+      for( int i = 0; i < 3; ++i)
+         log->message(LL_info) << "flood";
+      log->setOutputChain( new bufferingChainLink( LL_debug));
+      CPPUNIT_ASSERT_EQUAL( std::size_t(2), messages.size());
+      CPPUNIT_ASSERT_EQUAL( std::string("2 messages suppressed by rate limit"), messages[1]);
+
+      messages.clear();
+      log->setOutputChain( new rateLimitingChainLink( 0.1, 1, new recordingChainLink( messages)));
+      for( int i = 0; i < 4; ++i)
+         log->message(LL_info) << "flood";
+      delete log;
+      log = new Log;
+      CPPUNIT_ASSERT_EQUAL( std::size_t(2), messages.size());
+      CPPUNIT_ASSERT_EQUAL( std::string("3 messages suppressed by rate limit"), messages[1]);
+   }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(ratelimit_test);
@@ -0,0 +1,94 @@
+#include <cppunit/extensions/HelperMacros.h>
+#include "../Log.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <algorithm>
+
+//! counts messages into a counter shared by all chains
+class sharedCountingChainLink : public outputChain {
+public:
+   sharedCountingChainLink( std::atomic<unsigned long>& count, std::atomic<int>& alive)
+   : outputChain( LL_debug, true, 0), count(count), alive(alive) {
+      ++alive;
+   }
+
+   ~sharedCountingChainLink() {
+      --alive;
+   }
+
+protected:
+   void real_log( LogLevel /* ll */, const std::string& str) {
+      if( str.size())
+         ++count;
+   }
+
+private:
+   std::atomic<unsigned long>& count;
+   std::atomic<int>& alive;
+};
+
+class rcu_test : public CppUnit::TestFixture
+{
+   CPPUNIT_TEST_SUITE(rcu_test);
+   CPPUNIT_TEST(swapWhileLogging);
+   CPPUNIT_TEST(swapWhileLoggingAsync);
+   CPPUNIT_TEST_SUITE_END();
+
+private:
+   void stress( bool async) {
+      const int threads = 8;
+      const int messages = 20000;
+      std::atomic<unsigned long> count(0);
+      std::atomic<int> alive(0);
+      std::atomic<bool> done(false);
+      int maxAlive = 0;
+
+      {
+         Log log;
+         log.setOutputChain( new taggingChainLink( new sharedCountingChainLink( count, alive)));
+         if( async)
+            log.startAsync( 64);
+
+         std::vector<std::thread> writers;
+         for( int t = 0; t < threads; ++t) {
+            writers.push_back( std::thread( [&log, t] {
+               for( int i = 0; i < messages; ++i)
+                  log.message(LL_info) << "thread " << t << " message " << i;
+            }));
+         }
+
+         std::thread swapper( [&] {
+            while( !done) {
+               log.setOutputChain( new sharedCountingChainLink( count, alive));
+               log.setOutputChain( new taggingChainLink( new sharedCountingChainLink( count, alive)));
+               maxAlive = std::max( maxAlive, alive.load());
+            }
+         });
+
+         for( auto& w : writers)
+            w.join();
+         done = true;
+         swapper.join();
+      }
+
+      CPPUNIT_ASSERT_EQUAL( static_cast<unsigned long>(threads * messages), count.load());
+      CPPUNIT_ASSERT_EQUAL( 0, alive.load());
+      // the old chain is deleted before setOutputChain returns
+      CPPUNIT_ASSERT( maxAlive <= 1);
+   }
+
+public:
+   void swapWhileLogging()
+   {
+      stress( false);
+   }
+
+   void swapWhileLoggingAsync()
+   {
+      stress( true);
+   }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(rcu_test);
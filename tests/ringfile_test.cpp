@@ -0,0 +1,88 @@
+#include <cppunit/extensions/HelperMacros.h>
+#include "../Log.h"
+
+#include <cstdio>
+#include <string>
+
+class ringfile_test : public CppUnit::TestFixture
+{
+   CPPUNIT_TEST_SUITE(ringfile_test);
+   CPPUNIT_TEST(fewMessages);
+   CPPUNIT_TEST(wrapAround);
+   CPPUNIT_TEST(continueFile);
+   CPPUNIT_TEST(truncate);
+   CPPUNIT_TEST_SUITE_END();
+
+private:
+   static const char* filename;
+
+   void logMessages( std::size_t capacity, int first, int last) {
+      Log log;
+      log.setOutputChain( new ringFileChainLink( filename, capacity, LL_debug));
+      for( int i = first; i < last; ++i)
+         log.message( i % 2 ? LL_info : LL_error) << "message " << i;
+   }
+
+   //! the messages have to be the newest ones, complete and in order
+   void checkMessages( const ringFileChainLink::Messages& messages, int last) {
+      int first = last - static_cast<int>(messages.size());
+      for( std::size_t i = 0; i < messages.size(); ++i) {
+         int n = first + static_cast<int>(i);
+         CPPUNIT_ASSERT_EQUAL( "message " + std::to_string(n), messages[i].second);
+         CPPUNIT_ASSERT( messages[i].first == ( n % 2 ? LL_info : LL_error));
+      }
+   }
+
+public:
+   void tearDown()
+   {
+      std::remove( filename);
+   }
+
+   void fewMessages()
+   {
+      logMessages( 4096, 0, 10);
+      auto messages = ringFileChainLink::readMessages( filename);
+      CPPUNIT_ASSERT_EQUAL( std::size_t(10), messages.size());
+      checkMessages( messages, 10);
+   }
+
+   void wrapAround()
+   {
+      logMessages( 1024, 0, 1000);
+      auto messages = ringFileChainLink::readMessages( filename);
+      // records take 40 bytes, so about 25 fit
+      CPPUNIT_ASSERT( messages.size() > 20);
+      CPPUNIT_ASSERT( messages.size() < 26);
+      checkMessages( messages, 1000);
+   }
+
+   void continueFile()
+   {
+      logMessages( 1024, 0, 5);
+      logMessages( 1024, 5, 10);
+      auto messages = ringFileChainLink::readMessages( filename);
+      CPPUNIT_ASSERT_EQUAL( std::size_t(10), messages.size());
+      checkMessages( messages, 10);
+
+      // a different capacity starts a new file
+      logMessages( 2048, 10, 12);
+      CPPUNIT_ASSERT_EQUAL( std::size_t(2), ringFileChainLink::readMessages( filename).size());
+   }
+
+   void truncate()
+   {
+      {
+         Log log;
+         log.setOutputChain( new ringFileChainLink( filename, 1024, LL_debug));
+         log.message(LL_info) << std::string( 1000, 'x');
+      }
+      auto messages = ringFileChainLink::readMessages( filename);
+      CPPUNIT_ASSERT_EQUAL( std::size_t(1), messages.size());
+      CPPUNIT_ASSERT_EQUAL( std::string( 1024 / 4 - 24, 'x'), messages[0].second);
+   }
+};
+
+const char* ringfile_test::filename = "ringfile_test.log";
+
+CPPUNIT_TEST_SUITE_REGISTRATION(ringfile_test);
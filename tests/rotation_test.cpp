@@ -0,0 +1,162 @@
+#include <cppunit/extensions/HelperMacros.h>
+#include "../Log.h"
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#ifdef LOG_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+namespace {
+   std::string contents( const std::string& filename) {
+      std::ifstream in( filename.c_str());
+      std::ostringstream s;
+      s << in.rdbuf();
+      return s.str();
+   }
+
+   bool exists( const std::string& filename) {
+      return std::ifstream( filename.c_str()).good();
+   }
+
+#ifdef LOG_HAVE_ZLIB
+   std::string gzContents( const std::string& filename) {
+      std::string s;
+      gzFile in = gzopen( filename.c_str(), "rb");
+      if( !in)
+         return s;
+      char chunk[4096];
+      int n;
+      while( ( n = gzread( in, chunk, sizeof(chunk))) > 0)
+         s.append( chunk, static_cast<std::size_t>(n));
+      gzclose( in);
+      return s;
+   }
+#endif
+
+   //! waits until the background thread created the file
+   bool waitFor( const std::string& filename) {
+      for( int i = 0; i < 1000 && !exists( filename); ++i)
+         std::this_thread::sleep_for( std::chrono::milliseconds(2));
+      return exists( filename);
+   }
+
+   //! waits until the file was rotated n times
+   bool waitFor( const fileChainLink* file, std::size_t n) {
+      for( int i = 0; i < 1000 && file->rotations() < n; ++i)
+         std::this_thread::sleep_for( std::chrono::milliseconds(2));
+      return file->rotations() >= n;
+   }
+} // namespace
+
+class rotation_test : public CppUnit::TestFixture
+{
+   CPPUNIT_TEST_SUITE(rotation_test);
+   CPPUNIT_TEST(bySize);
+   CPPUNIT_TEST(keepLimit);
+   CPPUNIT_TEST(byTime);
+#ifdef LOG_HAVE_ZLIB
+   CPPUNIT_TEST(compressed);
+#endif
+   CPPUNIT_TEST_SUITE_END();
+
+private:
+   static const std::string filename;
+
+   std::string rotated( int n, bool compressed = false) {
+      return filename + "." + std::to_string(n) + ( compressed ? ".gz" : "");
+   }
+
+public:
+   void tearDown()
+   {
+      std::remove( filename.c_str());
+      for( int n = 1; n < 10; ++n) {
+         std::remove( rotated( n).c_str());
+         std::remove( rotated( n, true).c_str());
+      }
+   }
+
+   //! all messages end up in the files, in order
+   void bySize()
+   {
+      {
+         Log log;
+         auto file = new fileChainLink( filename, true, LL_debug);
+         file->setRotation( 100, std::chrono::seconds(0), 9);
+         log.setOutputChain( file);
+         for( int i = 0; i < 10; ++i) {
+            log.message(LL_info) << "message " << i << std::string( 40, '.');
+            // let the background thread rotate after each file filled up
+            if( i % 2)
+               CPPUNIT_ASSERT( waitFor( file, std::size_t( ( i + 1) / 2)));
+         }
+      }
+
+      std::string all;
+      for( int n = 9; n > 0; --n)
+         all += contents( rotated( n));
+      all += contents( filename);
+
+      std::string expected;
+      for( int i = 0; i < 10; ++i)
+         expected += "message " + std::to_string(i) + std::string( 40, '.') + "\n";
+      CPPUNIT_ASSERT_EQUAL( expected, all);
+      CPPUNIT_ASSERT_EQUAL( std::string(), contents( filename));
+   }
+
+   void keepLimit()
+   {
+      {
+         Log log;
+         auto file = new fileChainLink( filename, true, LL_debug);
+         file->setRotation( 10, std::chrono::seconds(0), 2);
+         log.setOutputChain( file);
+         for( int i = 0; i < 5; ++i) {
+            log.message(LL_info) << "message " << i << " is long enough";
+            CPPUNIT_ASSERT( waitFor( file, std::size_t( i + 1)));
+         }
+      }
+
+      CPPUNIT_ASSERT_EQUAL( std::string("message 4 is long enough\n"), contents( rotated( 1)));
+      CPPUNIT_ASSERT_EQUAL( std::string("message 3 is long enough\n"), contents( rotated( 2)));
+      CPPUNIT_ASSERT( !exists( rotated( 3)));
+   }
+
+   void byTime()
+   {
+      Log log;
+      auto file = new fileChainLink( filename, true, LL_debug);
+      file->setRotation( 0, std::chrono::seconds(1), 1);
+      log.setOutputChain( file);
+      log.message(LL_info) << "first";
+      CPPUNIT_ASSERT( waitFor( file, 1));
+      log.message(LL_info) << "second";
+      CPPUNIT_ASSERT_EQUAL( std::string("first\n"), contents( rotated( 1)));
+      CPPUNIT_ASSERT_EQUAL( std::string("second\n"), contents( filename));
+   }
+
+#ifdef LOG_HAVE_ZLIB
+   void compressed()
+   {
+      {
+         Log log;
+         auto file = new fileChainLink( filename, true, LL_debug);
+         file->setRotation( 10, std::chrono::seconds(0), 3, true);
+         log.setOutputChain( file);
+         log.message(LL_info) << "compress me please";
+         CPPUNIT_ASSERT( waitFor( rotated( 1, true)));
+      }
+      CPPUNIT_ASSERT_EQUAL( std::string("compress me please\n"), gzContents( rotated( 1, true)));
+      CPPUNIT_ASSERT( !exists( rotated( 1)));
+   }
+#endif
+};
+
+const std::string rotation_test::filename = "rotation_test.log";
+
+CPPUNIT_TEST_SUITE_REGISTRATION(rotation_test);
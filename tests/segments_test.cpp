@@ -0,0 +1,150 @@
+#include <cppunit/extensions/HelperMacros.h>
+#include "../Log.h"
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+namespace {
+   std::string contents( const char* filename) {
+      std::ifstream in( filename);
+      std::ostringstream s;
+      s << in.rdbuf();
+      return s.str();
+   }
+
+   std::string joined( const iovec* parts, std::size_t count) {
+      std::string text;
+      for( std::size_t i = 0; i < count; ++i)
+         text.append( static_cast<const char*>(parts[i].iov_base), parts[i].iov_len);
+      return text;
+   }
+
+   //! remembers the text shared by the last message
+   class sharingChainLink : public outputChain {
+   public:
+      sharingChainLink( outputChain* nextLink = 0)
+      : outputChain( LL_debug, true, nextLink) {}
+
+      LogRecord::SharedText last;
+
+   protected:
+      void real_log( LogLevel /* ll */, const std::string& /* str */) {}
+
+      void real_logRecord( const LogRecord& rec) {
+         last = rec.share();
+      }
+   };
+
+   //! remembers the number of segments of the last message
+   class segmentsChainLink : public outputChain {
+   public:
+      segmentsChainLink( outputChain* nextLink = 0)
+      : outputChain( LL_debug, true, nextLink)
+      , count( 0) {}
+
+      std::size_t count;
+
+   protected:
+      void real_log( LogLevel /* ll */, const std::string& /* str */) {}
+
+      void real_logRecord( const LogRecord& rec) {
+         iovec parts[LogRecord::maxSegments];
+         count = rec.segments( parts);
+      }
+   };
+} // namespace
+
+class segments_test : public CppUnit::TestFixture
+{
+   CPPUNIT_TEST_SUITE(segments_test);
+   CPPUNIT_TEST(prefixes);
+   CPPUNIT_TEST(deeplyDecorated);
+   CPPUNIT_TEST(taggedFile);
+   CPPUNIT_TEST(shared);
+   CPPUNIT_TEST_SUITE_END();
+
+private:
+   static const char* filename;
+
+public:
+   void tearDown()
+   {
+      std::remove( filename);
+   }
+
+   void prefixes()
+   {
+      std::string text( "message");
+      LogRecord original( LL_info, text);
+      LogRecord tagged( original, "tag ", 4);
+      LogRecord twice( tagged, "[x] ", 4);
+
+      iovec parts[LogRecord::maxSegments];
+      CPPUNIT_ASSERT_EQUAL( std::size_t(3), twice.segments( parts));
+      CPPUNIT_ASSERT( parts[2].iov_base == text.data());
+      CPPUNIT_ASSERT_EQUAL( std::string("[x] tag message"), joined( parts, 3));
+      CPPUNIT_ASSERT_EQUAL( std::size_t(15), twice.size());
+      CPPUNIT_ASSERT_EQUAL( std::string("[x] tag message"), twice.text());
+      CPPUNIT_ASSERT( twice.level() == LL_info);
+      CPPUNIT_ASSERT_EQUAL( original.time(), twice.time());
+
+      // joined once, afterwards the text is written as one part
+      CPPUNIT_ASSERT_EQUAL( std::size_t(1), twice.segments( parts));
+      CPPUNIT_ASSERT( parts[0].iov_base == twice.text().data());
+   }
+
+   void deeplyDecorated()
+   {
+      std::string text( "message");
+      LogRecord original( LL_info, text);
+      LogRecord r1( original, "1", 1), r2( r1, "2", 1), r3( r2, "3", 1), r4( r3, "4", 1),
+         r5( r4, "5", 1), r6( r5, "6", 1), r7( r6, "7", 1), r8( r7, "8", 1), r9( r8, "9", 1);
+
+      iovec parts[LogRecord::maxSegments];
+      std::size_t count = r9.segments( parts);
+      CPPUNIT_ASSERT( count <= LogRecord::maxSegments);
+      CPPUNIT_ASSERT_EQUAL( std::string("987654321message"), joined( parts, count));
+      CPPUNIT_ASSERT_EQUAL( std::size_t(8), r7.segments( parts));
+   }
+
+   void taggedFile()
+   {
+      fileChainLink* buffered = new fileChainLink( filename, true, LL_info);
+      buffered->setBuffering( 4096);
+      Log log;
+      log.setOutputChain( new taggingChainLink( buffered, TF_elapsed, 1));
+      log.message(LL_info) << "first";
+      log.flush();
+      segmentsChainLink* probe = new segmentsChainLink( new fileChainLink( filename, false, LL_info));
+      log.setOutputChain( new taggingChainLink( probe, TF_elapsed, 1));
+      log.message(LL_info) << "second";
+
+      CPPUNIT_ASSERT_EQUAL( std::string("  0.0 first\n  0.0 second\n"), contents( filename));
+      // the tagging link writes nothing, so the prefix is not joined before the file link
+      CPPUNIT_ASSERT_EQUAL( std::size_t(2), probe->count);
+      CPPUNIT_ASSERT_EQUAL( 0ull, log.metrics().links[0].bytes);
+      CPPUNIT_ASSERT_EQUAL( 12ull, log.metrics().links[2].bytes);
+   }
+
+   //! links keeping the message share one copy of its text
+   void shared()
+   {
+      bufferingChainLink* buffer = new bufferingChainLink( LL_debug);
+      sharingChainLink* last = new sharingChainLink( buffer);
+      sharingChainLink* first = new sharingChainLink( last);
+      Log log;
+      log.setOutputChain( first);
+      log.message(LL_info) << "kept";
+
+      CPPUNIT_ASSERT( first->last);
+      CPPUNIT_ASSERT( first->last == last->last);
+      CPPUNIT_ASSERT_EQUAL( std::string("kept"), *first->last);
+      CPPUNIT_ASSERT_EQUAL( std::string("kept"), buffer->getMessages().at(0).second);
+   }
+};
+
+const char* segments_test::filename = "segments_test.log";
+
+CPPUNIT_TEST_SUITE_REGISTRATION(segments_test);
@@ -0,0 +1,131 @@
+#include <cppunit/extensions/HelperMacros.h>
+#include "../Log.h"
+
+#include <clocale>
+#include <string>
+#include <sstream>
+#include <limits>
+
+template<typename T>
+static std::string streamed( const T& item) {
+   std::ostringstream s;
+   s << item;
+   return s.str();
+}
+
+class stringify_test : public CppUnit::TestFixture
+{
+   CPPUNIT_TEST_SUITE(stringify_test);
+   CPPUNIT_TEST(integers);
+   CPPUNIT_TEST(floats);
+   CPPUNIT_TEST(pointers);
+   CPPUNIT_TEST(writer);
+   CPPUNIT_TEST(cLocale);
+   CPPUNIT_TEST_SUITE_END();
+
+private:
+   template<typename T>
+   void check( T item) {
+      char buffer[LIB::max_chars];
+      std::string converted( buffer, LIB::to_chars( buffer, item));
+      CPPUNIT_ASSERT_EQUAL( streamed( item), converted);
+   }
+
+   template<typename T>
+   void checkLimits() {
+      check( std::numeric_limits<T>::min());
+      check( std::numeric_limits<T>::max());
+      check( static_cast<T>(0));
+      check( static_cast<T>(7));
+      check( static_cast<T>(10));
+      check( static_cast<T>(99));
+      check( static_cast<T>(100));
+      check( static_cast<T>(12345));
+   }
+
+public:
+   void integers()
+   {
+      checkLimits<short>();
+      checkLimits<unsigned short>();
+      checkLimits<int>();
+      checkLimits<unsigned int>();
+      checkLimits<long>();
+      checkLimits<unsigned long>();
+      checkLimits<long long>();
+      checkLimits<unsigned long long>();
+      check( -1);
+      check( -100);
+   }
+
+   void floats()
+   {
+      const double values[] = { 0.0, -0.0, 0.1, 1.5, -2.25, 3.14159265, 100000.0, 1e6, 1e-5,
+         1.0/3, 123456789.0, 1e300, -1e-300, std::numeric_limits<double>::infinity(),
+         std::numeric_limits<double>::max(), std::numeric_limits<double>::denorm_min() };
+      for( double v : values) {
+         check( v);
+         check( static_cast<float>(v));
+         check( static_cast<long double>(v));
+      }
+   }
+
+   void pointers()
+   {
+      int i = 0;
+      check( static_cast<const void*>(0));
+      check( static_cast<const void*>(&i));
+   }
+
+   void writer()
+   {
+      Log log;
+      auto buffer = new bufferingChainLink(LL_debug);
+      log.setOutputChain(buffer);
+
+      int i = 0;
+      char text[] = "text";
+      const char* ctext = "ctext";
+      unsigned char uc = 200;
+      signed char sc = 'x';
+      log.message(LL_info) << -42 << ' ' << 42u << ' ' << 2.5 << ' ' << 1.5f << ' ' << true << ' ' << uc << ' ' << sc;
+      log.message(LL_info) << text << ' ' << ctext << ' ' << std::string("string") << ' ' << &i;
+
+      auto messages = buffer->getMessages();
+      CPPUNIT_ASSERT_EQUAL( std::string("-42 42 2.5 1.5 true 200 x"), messages.at(0).second);
+      CPPUNIT_ASSERT_EQUAL( "text ctext string " + streamed(&i), messages.at(1).second);
+   }
+
+   //! floats keep their decimal point under a C locale writing a comma
+   void cLocale()
+   {
+      // the locale of the environment is the last resort
+      const char* commaLocales[] = { "de_DE.UTF-8", "de_DE.utf8", "fr_FR.UTF-8", "fr_FR.utf8", "" };
+      std::string previous = std::setlocale( LC_ALL, 0);
+      bool comma = false;
+      for( const char* name : commaLocales) {
+         if( std::setlocale( LC_ALL, name) && std::string( std::localeconv()->decimal_point) == ",") {
+            comma = true;
+            break;
+         }
+      }
+
+      if( comma) {
+         char buffer[LIB::max_chars];
+         CPPUNIT_ASSERT_EQUAL( std::string("1.5"), std::string( buffer, LIB::to_chars( buffer, 1.5)));
+         CPPUNIT_ASSERT_EQUAL( std::string("-2.25"), std::string( buffer, LIB::to_chars( buffer, -2.25f)));
+         CPPUNIT_ASSERT_EQUAL( std::string("1.5e-07"), std::string( buffer, LIB::to_chars( buffer, 1.5e-7L)));
+
+         Log log;
+         auto buffered = new bufferingChainLink( LL_debug);
+         log.setOutputChain( buffered);
+         log.message(LL_info) << 2.5;
+         LOG_DEFERRED( log, LL_info, "ratio {}", 0.75);
+         CPPUNIT_ASSERT_EQUAL( std::string("2.5"), buffered->getMessages().at(0).second);
+         CPPUNIT_ASSERT_EQUAL( std::string("ratio 0.75"), buffered->getMessages().at(1).second);
+      }
+      std::setlocale( LC_ALL, previous.c_str());
+   }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(stringify_test);
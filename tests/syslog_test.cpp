@@ -0,0 +1,196 @@
+#include <cppunit/extensions/HelperMacros.h>
+#include "../Log.h"
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+   //! a unix datagram socket standing in for the syslog daemon
+   /*!
+    * Receives on a thread, since only a few datagrams can wait in a unix
+    * socket.
+    */
+   class SyslogDaemon {
+   public:
+      SyslogDaemon( const char* path)
+      : path( path)
+      , stop( false) {
+         std::remove( path);
+         fd = ::socket( AF_UNIX, SOCK_DGRAM, 0);
+         sockaddr_un address;
+         std::memset( &address, 0, sizeof(address));
+         address.sun_family = AF_UNIX;
+         std::strcpy( address.sun_path, path);
+         if( ::bind( fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)))
+            throw std::runtime_error("could not bind syslog socket");
+         receiver = std::thread( [this] {
+            while( !stop) {
+               pollfd p = { fd, POLLIN, 0 };
+               if( ::poll( &p, 1, 10) > 0)
+                  receive();
+            }
+         });
+      }
+
+      ~SyslogDaemon() {
+         if( receiver.joinable()) {
+            stop = true;
+            receiver.join();
+         }
+         ::close( fd);
+         std::remove( path);
+      }
+
+      //! all frames received, stops receiving
+      std::vector<std::string> frames() {
+         stop = true;
+         receiver.join();
+         receive();
+         return received;
+      }
+
+   private:
+      void receive() {
+         char frame[4096];
+         ssize_t len;
+         while( ( len = ::recv( fd, frame, sizeof(frame), MSG_DONTWAIT)) >= 0)
+            received.push_back( std::string( frame, static_cast<std::size_t>(len)));
+      }
+
+      const char* path;
+      int fd;
+      std::atomic<bool> stop;
+      std::thread receiver;
+      std::vector<std::string> received;
+   };
+
+   bool endsWith( const std::string& str, const std::string& end) {
+      return str.size() >= end.size() && !str.compare( str.size() - end.size(), end.size(), end);
+   }
+} // namespace
+
+class syslog_test : public CppUnit::TestFixture
+{
+   CPPUNIT_TEST_SUITE(syslog_test);
+   CPPUNIT_TEST(rfc3164);
+   CPPUNIT_TEST(rfc5424);
+   CPPUNIT_TEST(identities);
+   CPPUNIT_TEST(threads);
+   CPPUNIT_TEST(noDaemon);
+   CPPUNIT_TEST_SUITE_END();
+
+private:
+   static const char* socketPath;
+
+   std::string pid() {
+      return std::to_string( ::getpid());
+   }
+
+public:
+   void rfc3164()
+   {
+      SyslogDaemon daemon( socketPath);
+      {
+         Log log;
+         log.setOutputChain( new syslogSocketChainLink( "test", LL_info, socketPath));
+         log.message(LL_info) << "hello " << 42;
+         log.message(LL_error) << "failed";
+         log.message(LL_debug) << "not written";
+      }
+
+      auto frames = daemon.frames();
+      CPPUNIT_ASSERT_EQUAL( std::size_t(2), frames.size());
+      // user facility, "<14>May 17 08:15:42 test[123]: hello 42"
+      CPPUNIT_ASSERT_EQUAL( std::string("<14>"), frames[0].substr( 0, 4));
+      CPPUNIT_ASSERT_EQUAL( ' ', frames[0][7]);
+      CPPUNIT_ASSERT_EQUAL( ':', frames[0][13]);
+      CPPUNIT_ASSERT_EQUAL( " test[" + pid() + "]: hello 42", frames[0].substr( 19));
+      CPPUNIT_ASSERT_EQUAL( std::string("<11>"), frames[1].substr( 0, 4));
+      CPPUNIT_ASSERT( endsWith( frames[1], "]: failed"));
+   }
+
+   void rfc5424()
+   {
+      SyslogDaemon daemon( socketPath);
+      {
+         Log log;
+         log.setOutputChain( new syslogSocketChainLink( "test", LL_info, socketPath, SF_rfc5424, 16));
+         LOG_DEFERRED( log, LL_warning, "deferred {}", 1);
+      }
+
+      auto frames = daemon.frames();
+      CPPUNIT_ASSERT_EQUAL( std::size_t(1), frames.size());
+      // local0 facility, "<132>1 2024-05-17T08:15:42.123456Z host test 123 - - deferred 1"
+      CPPUNIT_ASSERT_EQUAL( std::string("<132>1 "), frames[0].substr( 0, 7));
+      CPPUNIT_ASSERT_EQUAL( std::string("Z "), frames[0].substr( 33, 2));
+      CPPUNIT_ASSERT( endsWith( frames[0], " test " + pid() + " - - deferred 1"));
+   }
+
+   //! links with different identities do not interfere
+   void identities()
+   {
+      SyslogDaemon daemon( socketPath);
+      {
+         Log first;
+         Log second;
+         first.setOutputChain( new syslogSocketChainLink( "first", LL_info, socketPath));
+         second.setOutputChain( new syslogSocketChainLink( "second", LL_info, socketPath));
+         first.message(LL_info) << "one";
+         second.message(LL_info) << "two";
+         first.message(LL_info) << "three";
+      }
+
+      auto frames = daemon.frames();
+      CPPUNIT_ASSERT_EQUAL( std::size_t(3), frames.size());
+      CPPUNIT_ASSERT( endsWith( frames[0], " first[" + pid() + "]: one"));
+      CPPUNIT_ASSERT( endsWith( frames[1], " second[" + pid() + "]: two"));
+      CPPUNIT_ASSERT( endsWith( frames[2], " first[" + pid() + "]: three"));
+   }
+
+   //! frames of threads logging at once are batched, none is lost
+   void threads()
+   {
+      SyslogDaemon daemon( socketPath);
+      Log log;
+      log.setOutputChain( new syslogSocketChainLink( "test", LL_info, socketPath));
+      std::vector<std::thread> writers;
+      for( int t = 0; t < 4; ++t) {
+         writers.push_back( std::thread( [&log, t] {
+            for( int i = 0; i < 25; ++i)
+               log.message(LL_info) << "thread " << t << " message " << i;
+         }));
+      }
+      for( auto& w : writers)
+         w.join();
+      log.flush();
+
+      auto frames = daemon.frames();
+      CPPUNIT_ASSERT_EQUAL( std::size_t(100), frames.size());
+      // in order per thread
+      std::vector<int> next( 4, 0);
+      for( auto& frame : frames) {
+         std::size_t pos = frame.find( "thread ");
+         int t = frame[pos + 7] - '0';
+         CPPUNIT_ASSERT( endsWith( frame, " message " + std::to_string( next[t]++)));
+      }
+   }
+
+   void noDaemon()
+   {
+      std::remove( socketPath);
+      CPPUNIT_ASSERT_THROW( syslogSocketChainLink( "test", LL_info, socketPath), std::invalid_argument);
+   }
+};
+
+const char* syslog_test::socketPath = "syslog_test.sock";
+
+CPPUNIT_TEST_SUITE_REGISTRATION(syslog_test);
@@ -0,0 +1,32 @@
+#include "../Log.h"
+
+#include <iostream>
+#include <stdexcept>
+
+/*!
+ * \file logbin_decode.cpp
+ * \ingroup Logging
+ *
+ * Prints the messages of a binary log file written by binaryFileChainLink,
+ * formatting the deferred messages.
+ */
+
+namespace {
+	const char* levelNames[] = { "emerg", "alert", "critical", "error", "warning", "notice", "info", "debug" };
+} // namespace
+
+int main( int argc, char* argv[]) {
+	if( argc != 2) {
+		std::cerr << "usage: " << argv[0] << " <binary log file>" << std::endl;
+		return 1;
+	}
+
+	try {
+		for( auto& message : binaryFileChainLink::readMessages( argv[1]))
+			std::cout << levelNames[message.first] << ": " << message.second << '\n';
+	} catch( const std::exception& e) {
+		std::cerr << argv[1] << ": " << e.what() << std::endl;
+		return 1;
+	}
+	return 0;
+}
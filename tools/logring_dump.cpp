@@ -0,0 +1,32 @@
+#include "../Log.h"
+
+#include <iostream>
+#include <stdexcept>
+
+/*!
+ * \file logring_dump.cpp
+ * \ingroup Logging
+ *
+ * Prints the messages held by a ring file written by ringFileChainLink,
+ * oldest first.
+ */
+
+namespace {
+	const char* levelNames[] = { "emerg", "alert", "critical", "error", "warning", "notice", "info", "debug" };
+} // namespace
+
+int main( int argc, char* argv[]) {
+	if( argc != 2) {
+		std::cerr << "usage: " << argv[0] << " <ring file>" << std::endl;
+		return 1;
+	}
+
+	try {
+		for( auto& message : ringFileChainLink::readMessages( argv[1]))
+			std::cout << levelNames[message.first] << ": " << message.second << '\n';
+	} catch( const std::exception& e) {
+		std::cerr << argv[1] << ": " << e.what() << std::endl;
+		return 1;
+	}
+	return 0;
+}